@@ -0,0 +1,505 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "netconv.h"
+#include "unfold.h"
+#include "mcipack.h"
+
+/*****************************************************************************/
+/* Badness oracle for -badchk: whether a marking of the net is covered by   */
+/* a reachable marking of the bad net, i.e. whether some configuration of   */
+/* the bad prefix (made of non-cutoff events) marks every place of it.     */
+/* This is the question the badness_check script answered with mci2sat,    */
+/* minisat and sateval; here the prefix <badunf>.mci is read once and the   */
+/* configurations are searched directly. The verdicts follow the script,   */
+/* including the way place names are matched (a place of the bad net also */
+/* matches a name if its name up to the last '_' is that name).       */
+
+typedef struct badcond_t
+{
+  int place;       /* place of the bad net */
+  int gen;         /* generating event, 0 for initial conditions */
+  int *post;       /* consuming non-cutoff events, 0-terminated */
+} badcond_t;
+
+/* The verdicts are cached by marking, in an open-addressing table that
+   is doubled when half full. With -badcache they are also kept in a
+   file, one line per marking: a hash of the bad prefix, the verdict and
+   the names of the marked places in alphabetical order, so that later
+   runs on the same bad prefix start from the verdicts found so far. */
+
+typedef struct badverdict_t
+{
+  marking_t *marking;
+  int verdict;
+} badverdict_t;
+
+char *badcache = NULL;   /* argument of -badcache */
+badverdict_t *bad_cache;
+int bad_cache_size, bad_cache_count;
+int bad_checks, bad_hits;
+unsigned long long bad_digest;  /* hash of <badunf>.mci */
+FILE *bad_cache_file;
+
+int bad_loaded = 0;      /* whether <badunf>.mci could be read */
+int bad_numco, bad_numev;
+badcond_t *bad_conds;    /* indexed by condition number, 1-based */
+int **bad_preset;        /* token conditions consumed by each event */
+int **bad_byplace;       /* conditions usable as a witness, per bad place */
+int **bad_match;         /* bad places matching each place of the net,
+                            NULL if its name does not occur in the prefix */
+
+/* state of the search */
+int *bad_consumer;       /* event of the configuration consuming a cond */
+int *bad_chosen;         /* conditions that must remain marked */
+char *bad_inconf;        /* events in the configuration */
+int *bad_trail, bad_trail_size; /* undo log: +e for events, -c for conds,
+                                   c (shifted) for chosen conditions */
+int bad_top;
+int *bad_stack;
+int *bad_wanted, *bad_wanted_mark;
+int bad_round;
+
+char *bad_blob, *bad_pos;
+
+static int bad_int ()
+{
+  int i;
+  memcpy(&i,bad_pos,sizeof(int));
+  bad_pos += sizeof(int);
+  return i;
+}
+
+/*****************************************************************************/
+/* The verdict cache.                    */
+
+badverdict_t* bad_cache_slot (marking_t *marking)
+{
+  int slot = marking->hash & (bad_cache_size - 1);
+
+  while (bad_cache[slot].marking
+      && marking_compare(bad_cache[slot].marking,marking))
+    slot = (slot + 1) & (bad_cache_size - 1);
+  return bad_cache + slot;
+}
+
+void bad_cache_add (marking_t *marking, int verdict)
+{
+  badverdict_t *old = bad_cache, *cell;
+  int i, size = bad_cache_size;
+
+  if (2 * ++bad_cache_count > bad_cache_size)
+  {
+    bad_cache = MYcalloc((bad_cache_size *= 2) * sizeof(badverdict_t));
+    for (i = 0; i < size; i++)
+      if (old[i].marking) *bad_cache_slot(old[i].marking) = old[i];
+    free(old);
+  }
+  cell = bad_cache_slot(marking);
+  cell->marking = marking_alloc();
+  memcpy(cell->marking,marking,
+    sizeof(marking_t) + marking_words * sizeof(unsigned long long));
+  cell->verdict = verdict;
+}
+
+int bad_name_cmp (const void *a, const void *b)
+{
+  return strcmp((*(place_t**)a)->name,(*(place_t**)b)->name);
+}
+
+/* Load the verdicts for this bad prefix from the -badcache file and
+   open it for appending new ones. */
+
+void bad_cache_init (long len)
+{
+  place_t **byname, key, *keyptr = &key, **found, *pl;
+  marking_t *marking;
+  char *line, *name, *next;
+  unsigned long long digest;
+  int verdict, i = 0, ok;
+  size_t size = 0;
+  FILE *file;
+  long k;
+
+  bad_digest = 0xcbf29ce484222325ULL;
+  for (k = 0; k < len; k++)
+    bad_digest = (bad_digest ^ (unsigned char)bad_blob[k]) * 0x100000001b3ULL;
+
+  bad_cache = MYcalloc((bad_cache_size = 1024) * sizeof(badverdict_t));
+  if (!badcache) return;
+
+  byname = MYmalloc(net->numpl * sizeof(place_t*));
+  for (pl = net->places; pl; pl = pl->next) byname[i++] = pl;
+  qsort(byname,net->numpl,sizeof(place_t*),bad_name_cmp);
+
+  line = NULL;
+  marking = marking_alloc();
+  if ((file = fopen(badcache,"r")))
+  {
+    while (getline(&line,&size,file) > 0)
+    {
+      if (sscanf(line,"%llx %d",&digest,&verdict) != 2
+          || digest != bad_digest) continue;
+      line[strcspn(line,"\n")] = 0;
+      name = strchr(strchr(line,' ') + 1,' ');
+      memset(marking->bits,0,marking_words * sizeof(unsigned long long));
+      for (ok = 1, name = name? name + 1 : ""; *name && ok; name = next)
+      {
+        if ((next = strchr(name,','))) *next++ = 0;
+        else next = name + strlen(name);
+        key.name = name;
+        if ((found = bsearch(&keyptr,byname,net->numpl,sizeof(place_t*),
+            bad_name_cmp)))
+          marking_set(marking,*found);
+        else
+          ok = 0;
+      }
+      if (!ok) continue;
+      marking_hash(marking);
+      if (!bad_cache_slot(marking)->marking)
+        bad_cache_add(marking,verdict);
+    }
+    fclose(file);
+  }
+  free(line);
+  free(marking);
+  free(byname);
+
+  if (!(bad_cache_file = fopen(badcache,"a")))
+    nc_error("cannot write to file %s",badcache);
+}
+
+/* Append a verdict to the -badcache file. */
+
+void bad_cache_write (marking_t *marking, int verdict)
+{
+  nodelist_t *list, *places = marking_to_list(marking);
+  place_t **sorted;
+  int i, n = 0;
+
+  for (list = places; list; list = list->next) n++;
+  sorted = MYmalloc((n + 1) * sizeof(place_t*));
+  for (n = 0, list = places; list; list = list->next)
+    sorted[n++] = list->node;
+  qsort(sorted,n,sizeof(place_t*),bad_name_cmp);
+
+  fprintf(bad_cache_file,"%016llx %d ",bad_digest,verdict);
+  for (i = 0; i < n; i++)
+    fprintf(bad_cache_file,"%s%s",i? "," : "",sorted[i]->name);
+  fprintf(bad_cache_file,"\n");
+  fflush(bad_cache_file);
+
+  free(sorted);
+  nodelist_delete(places);
+}
+
+/*****************************************************************************/
+/* Read the bad prefix and match its places against those of the net.     */
+
+void badness_init (char *badunf)
+{
+  char *filename = MYmalloc(strlen(badunf) + 5), **plname, *name;
+  int i, j, k, e, size, numpl, *count, *cutoff, *post, *consumers;
+  int *preset_size;
+  char *bconds, *present;
+  place_t *pl;
+  FILE *file;
+  long len;
+
+  sprintf(filename,"%s.mci",badunf);
+  if (!(file = fopen(filename,"rb")))
+  {
+    nc_warning("mci file %s does not exist",filename);
+    free(filename);
+    return;
+  }
+  fseek(file,0,SEEK_END);
+  len = ftell(file);
+  fseek(file,0,SEEK_SET);
+  bad_pos = bad_blob = MYmalloc(len);
+  if (fread(bad_blob,1,len,file) != len)
+    nc_error("cannot read file %s",filename);
+  fclose(file);
+  if (mci_is_packed(bad_blob,len))
+  {
+    int packed_flags;
+    char *plain = mci_unpack(bad_blob,len,&packed_flags,&len);
+    if (!plain) nc_error("%s: %s",filename,mci_pack_error);
+    free(bad_blob);
+    bad_pos = bad_blob = plain;
+  }
+  else if (mci_is_streamed(bad_blob,len))
+  {
+    char *plain = mci_unstream(bad_blob,len,&len);
+    if (!plain) nc_error("%s: %s",filename,mci_pack_error);
+    free(bad_blob);
+    bad_pos = bad_blob = plain;
+  }
+  free(filename);
+  bad_cache_init(len);
+
+  bad_numco = bad_int();
+  bad_numev = bad_int();
+
+  /* skip the query cells and the events */
+  while (bad_int())
+  {
+    i = bad_int(); j = bad_int();
+    bad_pos += (i + j) * sizeof(int);
+  }
+  bad_pos += 2 * bad_numev * sizeof(int);
+  bconds = bad_pos;
+  for (i = 1; i <= bad_numco; i++)
+  {
+    bad_pos += 4 * sizeof(int);
+    while (bad_int());
+  }
+  while (bad_int());  /* harmful events */
+
+  cutoff = MYcalloc((bad_numev + 1) * sizeof(int));
+  while ((e = bad_int())) { cutoff[e] = 1; bad_int(); }
+  while (bad_int());
+  numpl = bad_int();
+  bad_int(); bad_int();
+  plname = MYcalloc((numpl + 1) * sizeof(char*));
+  for (i = 1; i <= numpl; i++)
+  {
+    j = bad_int();
+    plname[j] = bad_pos;
+    bad_pos += strlen(bad_pos) + 1;
+  }
+
+  /* conditions with a token: generator, non-cutoff consumers */
+  bad_conds = MYcalloc((bad_numco + 1) * sizeof(badcond_t));
+  preset_size = MYcalloc((bad_numev + 1) * sizeof(int));
+  count = MYcalloc((numpl + 1) * sizeof(int));
+  consumers = MYmalloc((bad_numev + 1) * sizeof(int));
+  bad_pos = bconds;
+  for (i = 1; i <= bad_numco; i++)
+  {
+    int place = bad_int(), token = bad_int();
+    bad_int();
+    bad_conds[i].place = place;
+    bad_conds[i].gen = bad_int();
+    for (size = 0; (e = bad_int()); )
+      if (!cutoff[e]) consumers[size++] = e;
+    if (!token) { bad_conds[i].place = -place; continue; }
+    bad_conds[i].post = MYmalloc((size + 1) * sizeof(int));
+    memcpy(bad_conds[i].post,consumers,size * sizeof(int));
+    bad_conds[i].post[size] = 0;
+    for (j = 0; j < size; j++) preset_size[consumers[j]]++;
+    if (!bad_conds[i].gen || !cutoff[bad_conds[i].gen]) count[place]++;
+  }
+
+  bad_preset = MYmalloc((bad_numev + 1) * sizeof(int*));
+  for (e = 1; e <= bad_numev; e++)
+  {
+    bad_preset[e] = MYmalloc((preset_size[e] + 1) * sizeof(int));
+    preset_size[e] = 0;
+  }
+  bad_byplace = MYmalloc((numpl + 1) * sizeof(int*));
+  for (j = 1; j <= numpl; j++)
+  {
+    bad_byplace[j] = MYmalloc((count[j] + 1) * sizeof(int));
+    count[j] = 0;
+  }
+  for (i = 1; i <= bad_numco; i++)
+  {
+    if (bad_conds[i].place <= 0) continue;
+    for (post = bad_conds[i].post; *post; post++)
+      bad_preset[*post][preset_size[*post]++] = i;
+    if (!bad_conds[i].gen || !cutoff[bad_conds[i].gen])
+      bad_byplace[bad_conds[i].place][count[bad_conds[i].place]++] = i;
+  }
+  for (e = 1; e <= bad_numev; e++) bad_preset[e][preset_size[e]] = 0;
+  for (j = 1; j <= numpl; j++) bad_byplace[j][count[j]] = 0;
+
+  /* match the places of the net with those of the bad net; one of the
+     matching places must carry some condition */
+  present = MYcalloc(numpl + 1);
+  for (i = 1; i <= bad_numco; i++) present[abs(bad_conds[i].place)] = 1;
+  bad_match = MYcalloc((net->numpl + 1) * sizeof(int*));
+  for (pl = net->places; pl; pl = pl->next)
+  {
+    bad_match[pl->num] = MYmalloc((numpl + 1) * sizeof(int));
+    for (k = size = 0, j = 1; j <= numpl; j++)
+    {
+      if (!plname[j]) continue;
+      name = bltokstr(plname[j],0,'_');
+      if (!strcmp(plname[j],pl->name) || !strcmp(name,pl->name))
+      {
+        bad_match[pl->num][size++] = j;
+        k |= present[j];
+      }
+      free(name);
+    }
+    bad_match[pl->num][size] = 0;
+    if (!k)
+    {
+      free(bad_match[pl->num]);
+      bad_match[pl->num] = NULL;
+    }
+  }
+  free(present);
+
+  bad_consumer = MYcalloc((bad_numco + 1) * sizeof(int));
+  bad_chosen = MYcalloc((bad_numco + 1) * sizeof(int));
+  bad_inconf = MYcalloc(bad_numev + 1);
+  bad_stack = MYmalloc((bad_numev + 1) * sizeof(int));
+  bad_trail = MYmalloc((bad_trail_size = 1024) * sizeof(int));
+  bad_wanted = MYmalloc((numpl + 1) * sizeof(int));
+  bad_wanted_mark = MYcalloc((numpl + 1) * sizeof(int));
+  free(cutoff); free(preset_size); free(count); free(consumers); free(plname);
+  bad_loaded = 1;
+}
+
+/*****************************************************************************/
+/* The undo log of the search.                   */
+
+static void bad_log (int entry)
+{
+  if (bad_top == bad_trail_size)
+    bad_trail = MYrealloc(bad_trail,(bad_trail_size *= 2) * sizeof(int));
+  bad_trail[bad_top++] = entry;
+}
+
+static void bad_undo (int mark)
+{
+  int entry;
+
+  while (bad_top > mark)
+    if ((entry = bad_trail[--bad_top]) > 0) bad_inconf[entry] = 0;
+    else if (entry > -(bad_numco + 1)) bad_consumer[-entry] = 0;
+    else bad_chosen[-entry - bad_numco - 1] = 0;
+}
+
+/* Add the condition co and the causal past of its generator to the
+   configuration, keeping co marked. Fails if this leads to a conflict
+   or consumes a condition that must remain marked. */
+
+static int bad_add (int co)
+{
+  int sp = 0, e, *pre;
+
+  if (bad_consumer[co]) return 0;
+  if (!bad_chosen[co]) { bad_chosen[co] = 1; bad_log(-co - bad_numco - 1); }
+  if ((e = bad_conds[co].gen) && !bad_inconf[e])
+  {
+    bad_inconf[bad_stack[sp++] = e] = 1;
+    bad_log(e);
+  }
+  while (sp)
+    for (pre = bad_preset[bad_stack[--sp]]; *pre; pre++)
+    {
+      if (bad_consumer[*pre] || bad_chosen[*pre]) return 0;
+      bad_consumer[*pre] = bad_stack[sp];
+      bad_log(-*pre);
+      if ((e = bad_conds[*pre].gen) && !bad_inconf[e])
+      {
+        bad_inconf[bad_stack[sp++] = e] = 1;
+        bad_log(e);
+      }
+    }
+  return 1;
+}
+
+/* Choose a condition for the k-th wanted place and go on with the rest. */
+
+static int bad_search (int k, int nwanted)
+{
+  int *co, mark = bad_top;
+
+  if (k == nwanted) return 1;
+  for (co = bad_byplace[bad_wanted[k]]; *co; co++)
+  {
+    if (bad_add(*co) && bad_search(k + 1,nwanted)) return 1;
+    bad_undo(mark);
+  }
+  return 0;
+}
+
+/*****************************************************************************/
+/* Whether the marking is reachable in the bad prefix.         */
+
+int bad_reachable (marking_t *marking)
+{
+  int nwanted = 0, size = 0, i, j, *m, found;
+  nodelist_t *list, *places;
+
+  if (!bad_loaded) return 0;
+
+  bad_round++;
+  places = marking_to_list(marking);
+  for (list = places; list; list = list->next, size++)
+  {
+    if (!(m = bad_match[((place_t*)list->node)->num])) break;
+    for (; *m; m++)
+      if (bad_wanted_mark[*m] != bad_round)
+      {
+        bad_wanted_mark[*m] = bad_round;
+        bad_wanted[nwanted++] = *m;
+      }
+  }
+  nodelist_delete(places);
+  if (list || size > bad_numco - 1 || !nwanted) return 0;
+
+  /* places with fewer candidates first */
+  for (i = 1; i < nwanted; i++)
+  {
+    int pl = bad_wanted[i], n = 0;
+    for (m = bad_byplace[pl]; *m; m++) n++;
+    for (j = i; j > 0; j--)
+    {
+      int n2 = 0;
+      for (m = bad_byplace[bad_wanted[j-1]]; *m; m++) n2++;
+      if (n2 <= n) break;
+      bad_wanted[j] = bad_wanted[j-1];
+    }
+    bad_wanted[j] = pl;
+  }
+
+  bad_top = 0;
+  found = bad_search(0,nwanted);
+  bad_undo(0);
+  return found;
+}
+
+int badness_check (marking_t *marking)
+{
+  badverdict_t *cell;
+  int verdict;
+
+  if (!bad_loaded) return 0;
+
+  bad_checks++;
+  if ((cell = bad_cache_slot(marking))->marking)
+  {
+    bad_hits++;
+    return cell->verdict;
+  }
+  verdict = bad_reachable(marking);
+  bad_cache_add(marking,verdict);
+  if (bad_cache_file) bad_cache_write(marking,verdict);
+  return verdict;
+}
+
+void badness_finish ()
+{
+  int i;
+
+  if (bad_cache_file) fclose(bad_cache_file);
+  bad_cache_file = NULL;
+  for (i = 0; i < bad_cache_size; i++) free(bad_cache[i].marking);
+  free(bad_cache);
+  bad_cache = NULL;
+}
+
+void badness_stats ()
+{
+  if (!bad_loaded) return;
+  printf("Badness checks: %d, %d of them answered from the cache",
+    bad_checks,bad_hits);
+  if (badcache) printf(" (%s)",badcache);
+  printf("\n");
+}
@@ -0,0 +1,431 @@
+#include <string.h>
+
+#include "common.h"
+#include "cdcl.h"
+
+/****************************************************************************/
+/* Literals are stored as 2*var + sign. Clauses live one after the other   */
+/* in a pool of ints (size, then the literals) and are referred to by      */
+/* their offset; the first two literals of a clause are watched, and the   */
+/* first one of a reason clause is the literal it implied. Conflicts are   */
+/* analysed up to the first UIP, the learnt clauses are kept between calls */
+/* of cdcl_solve so that later targets profit from them. Decisions follow  */
+/* the variable activities (VSIDS) with phase saving, and the search is    */
+/* restarted along the Luby sequence.					    */
+
+#define LIT(l)   ((l) > 0 ? 2*(l) : -2*(l) + 1)
+#define VAR(p)   ((p) >> 1)
+#define UNDEF    -1
+
+typedef struct cdcl_watch_t
+{
+  int size, alloc;
+  int *refs;
+} cdcl_watch_t;
+
+struct cdcl_t
+{
+  int nvars, valloc;
+  signed char *val;     /* per variable: UNDEF, 0 or 1 */
+  signed char *model;
+  char *phase, *seen;
+  int *level, *reason;  /* reason: clause offset or UNDEF */
+  double *activity, var_inc;
+  int *heap, *heap_pos, heap_size;
+
+  int *trail, trail_size, qhead;
+  int *trail_lim, levels;
+
+  int *pool, pool_size, pool_alloc;
+  cdcl_watch_t *watches;  /* per literal */
+
+  int *learnt, learnt_alloc;
+  int ok;               /* 0 once the clauses are unsatisfiable */
+};
+
+/****************************************************************************/
+/* Values and the variable heap.					    */
+
+static int lit_value (cdcl_t *s, int p)
+{
+  int v = s->val[VAR(p)];
+  return v == UNDEF ? UNDEF : v ^ (p & 1);
+}
+
+static void heap_swap (cdcl_t *s, int i, int j)
+{
+  int t = s->heap[i];
+  s->heap[i] = s->heap[j]; s->heap[j] = t;
+  s->heap_pos[s->heap[i]] = i; s->heap_pos[s->heap[j]] = j;
+}
+
+static void heap_up (cdcl_t *s, int i)
+{
+  for (; i && s->activity[s->heap[i]] > s->activity[s->heap[(i-1)/2]];
+      i = (i-1)/2)
+    heap_swap(s,i,(i-1)/2);
+}
+
+static void heap_down (cdcl_t *s, int i)
+{
+  int c;
+
+  while ((c = 2*i + 1) < s->heap_size)
+  {
+    if (c + 1 < s->heap_size
+        && s->activity[s->heap[c+1]] > s->activity[s->heap[c]]) c++;
+    if (s->activity[s->heap[c]] <= s->activity[s->heap[i]]) break;
+    heap_swap(s,i,c);
+    i = c;
+  }
+}
+
+static void heap_insert (cdcl_t *s, int v)
+{
+  if (s->heap_pos[v] >= 0) return;
+  s->heap[s->heap_pos[v] = s->heap_size++] = v;
+  heap_up(s,s->heap_size - 1);
+}
+
+static int heap_pop (cdcl_t *s)
+{
+  int v = s->heap[0];
+
+  heap_swap(s,0,--s->heap_size);
+  s->heap_pos[v] = -1;
+  heap_down(s,0);
+  return v;
+}
+
+static void bump (cdcl_t *s, int v)
+{
+  int i;
+
+  if ((s->activity[v] += s->var_inc) > 1e100)
+  {
+    for (i = 1; i <= s->nvars; i++) s->activity[i] *= 1e-100;
+    s->var_inc *= 1e-100;
+  }
+  if (s->heap_pos[v] >= 0) heap_up(s,s->heap_pos[v]);
+}
+
+/****************************************************************************/
+/* Creating and releasing a solver, adding variables.			    */
+
+cdcl_t* cdcl_new ()
+{
+  cdcl_t *s = MYcalloc(sizeof(cdcl_t));
+
+  s->ok = 1;
+  s->var_inc = 1;
+  s->pool = MYmalloc((s->pool_alloc = 1024) * sizeof(int));
+  return s;
+}
+
+void cdcl_free (cdcl_t *s)
+{
+  int i;
+
+  for (i = 0; i < 2 * s->valloc; i++) free(s->watches[i].refs);
+  free(s->watches); free(s->val); free(s->model); free(s->phase);
+  free(s->seen); free(s->level); free(s->reason); free(s->activity);
+  free(s->heap); free(s->heap_pos); free(s->trail); free(s->trail_lim);
+  free(s->pool); free(s->learnt);
+  free(s);
+}
+
+int cdcl_newvar (cdcl_t *s)
+{
+  int v = ++s->nvars;
+
+  if (v >= s->valloc)
+  {
+    int old = s->valloc;
+    s->valloc = 2 * v + 16;
+    s->val = MYrealloc(s->val,s->valloc);
+    s->model = MYrealloc(s->model,s->valloc);
+    s->phase = MYrealloc(s->phase,s->valloc);
+    s->seen = MYrealloc(s->seen,s->valloc);
+    s->level = MYrealloc(s->level,s->valloc * sizeof(int));
+    s->reason = MYrealloc(s->reason,s->valloc * sizeof(int));
+    s->activity = MYrealloc(s->activity,s->valloc * sizeof(double));
+    s->heap = MYrealloc(s->heap,s->valloc * sizeof(int));
+    s->heap_pos = MYrealloc(s->heap_pos,s->valloc * sizeof(int));
+    s->trail = MYrealloc(s->trail,s->valloc * sizeof(int));
+    s->trail_lim = MYrealloc(s->trail_lim,s->valloc * sizeof(int));
+    s->watches = MYrealloc(s->watches,2 * s->valloc * sizeof(cdcl_watch_t));
+    memset(s->watches + 2*old,0,2 * (s->valloc - old) * sizeof(cdcl_watch_t));
+  }
+  s->val[v] = s->model[v] = UNDEF;
+  s->phase[v] = s->seen[v] = 0;
+  s->activity[v] = 0;
+  s->heap_pos[v] = -1;
+  heap_insert(s,v);
+  return v;
+}
+
+/****************************************************************************/
+/* Assignments, propagation and backtracking.				    */
+
+static void enqueue (cdcl_t *s, int p, int reason)
+{
+  int v = VAR(p);
+
+  s->val[v] = !(p & 1);
+  s->level[v] = s->levels;
+  s->reason[v] = reason;
+  s->trail[s->trail_size++] = p;
+}
+
+static void watch (cdcl_t *s, int p, int ref)
+{
+  cdcl_watch_t *w = s->watches + p;
+
+  if (w->size == w->alloc)
+    w->refs = MYrealloc(w->refs,(w->alloc = 2 * w->alloc + 4) * sizeof(int));
+  w->refs[w->size++] = ref;
+}
+
+/* Store a clause of at least two literals and watch its first two. */
+
+static int store (cdcl_t *s, int *lits, int n)
+{
+  int ref = s->pool_size;
+
+  if (s->pool_size + n + 1 > s->pool_alloc)
+    s->pool = MYrealloc(s->pool,(s->pool_alloc = 2 * (s->pool_size + n + 1))
+      * sizeof(int));
+  s->pool[ref] = n;
+  memcpy(s->pool + ref + 1,lits,n * sizeof(int));
+  s->pool_size += n + 1;
+  watch(s,lits[0],ref);
+  watch(s,lits[1],ref);
+  return ref;
+}
+
+/* Returns the offset of a conflicting clause, or UNDEF. */
+
+static int propagate (cdcl_t *s)
+{
+  while (s->qhead < s->trail_size)
+  {
+    int p = s->trail[s->qhead++] ^ 1;  /* the literal that became false */
+    cdcl_watch_t *w = s->watches + p;
+    int i, j, k, n = w->size;
+
+    for (i = j = 0; i < n; i++)
+    {
+      int ref = w->refs[i], *lits = s->pool + ref + 1, size = lits[-1], t;
+
+      if (lits[0] == p) { lits[0] = lits[1]; lits[1] = p; }
+      if (lit_value(s,lits[0]) == 1) { w->refs[j++] = ref; continue; }
+
+      for (k = 2; k < size; k++)
+        if (lit_value(s,lits[k]) != 0) break;
+      if (k < size)
+      {
+        t = lits[1]; lits[1] = lits[k]; lits[k] = t;
+        watch(s,lits[1],ref);
+        w = s->watches + p;
+        continue;
+      }
+
+      w->refs[j++] = ref;
+      if (lit_value(s,lits[0]) == 0)
+      {
+        while (++i < n) w->refs[j++] = w->refs[i];
+        w->size = j;
+        s->qhead = s->trail_size;
+        return ref;
+      }
+      enqueue(s,lits[0],ref);
+    }
+    w->size = j;
+  }
+  return UNDEF;
+}
+
+static void backtrack (cdcl_t *s, int level)
+{
+  int v;
+
+  if (s->levels <= level) return;
+  while (s->trail_size > s->trail_lim[level])
+  {
+    v = VAR(s->trail[--s->trail_size]);
+    s->phase[v] = s->val[v];
+    s->val[v] = UNDEF;
+    heap_insert(s,v);
+  }
+  s->qhead = s->trail_size;
+  s->levels = level;
+}
+
+/****************************************************************************/
+/* Conflict analysis: the learnt clause is left in s->learnt with the      */
+/* asserting literal first and one of the highest level after it; returns */
+/* the number of its literals and the level to jump back to.		    */
+
+static int analyze (cdcl_t *s, int confl, int *btlevel)
+{
+  int path = 0, p = UNDEF, n = 1, idx = s->trail_size - 1, i, v, max;
+
+  if (!s->learnt_alloc)
+    s->learnt = MYmalloc((s->learnt_alloc = 16) * sizeof(int));
+  do
+  {
+    int *lits = s->pool + confl + 1, size = lits[-1];
+
+    for (i = (p == UNDEF) ? 0 : 1; i < size; i++)
+    {
+      v = VAR(lits[i]);
+      if (s->seen[v] || !s->level[v]) continue;
+      s->seen[v] = 1;
+      bump(s,v);
+      if (s->level[v] >= s->levels)
+        path++;
+      else
+      {
+        if (n == s->learnt_alloc)
+          s->learnt = MYrealloc(s->learnt,
+            (s->learnt_alloc = 2 * n + 16) * sizeof(int));
+        s->learnt[n++] = lits[i];
+      }
+    }
+    while (!s->seen[VAR(s->trail[idx])]) idx--;
+    p = s->trail[idx--];
+    confl = s->reason[VAR(p)];
+    s->seen[VAR(p)] = 0;
+  } while (--path > 0);
+
+  s->learnt[0] = p ^ 1;
+
+  for (max = 1, i = 2; i < n; i++)
+    if (s->level[VAR(s->learnt[i])] > s->level[VAR(s->learnt[max])]) max = i;
+  *btlevel = 0;
+  if (n > 1)
+  {
+    v = s->learnt[max]; s->learnt[max] = s->learnt[1]; s->learnt[1] = v;
+    *btlevel = s->level[VAR(v)];
+  }
+  for (i = 1; i < n; i++) s->seen[VAR(s->learnt[i])] = 0;
+  s->var_inc *= 1 / 0.95;
+  return n;
+}
+
+/****************************************************************************/
+/* Add a clause, given as DIMACS literals. Only allowed between calls of  */
+/* cdcl_solve; the variables must have been created before.		    */
+
+void cdcl_add (cdcl_t *s, int *dimacs, int n)
+{
+  int *lits = MYmalloc((n + 1) * sizeof(int)), size = 0, i, j, p;
+
+  if (!s->ok) { free(lits); return; }
+  for (i = 0; i < n; i++)
+  {
+    p = LIT(dimacs[i]);
+    if (lit_value(s,p) == 1 && !s->level[VAR(p)]) { free(lits); return; }
+    if (lit_value(s,p) == 0 && !s->level[VAR(p)]) continue;
+    for (j = 0; j < size && lits[j] != p; j++)
+      if (lits[j] == (p ^ 1)) { free(lits); return; }
+    if (j == size) lits[size++] = p;
+  }
+
+  if (!size)
+    s->ok = 0;
+  else if (size == 1)
+  {
+    enqueue(s,lits[0],UNDEF);
+    if (propagate(s) != UNDEF) s->ok = 0;
+  }
+  else
+    store(s,lits,size);
+  free(lits);
+}
+
+/****************************************************************************/
+/* Solve under the given assumptions (DIMACS literals). Returns 1 if the   */
+/* clauses are satisfiable together with them; cdcl_model then gives the  */
+/* values of the variables in the solution that was found.		    */
+
+static int luby (int i)
+{
+  int size = 1, seq = 0;
+
+  while (size < i + 1) { seq++; size = 2 * size + 1; }
+  while (size - 1 != i)
+  {
+    size = (size - 1) / 2; seq--;
+    i = i % size;
+  }
+  return 1 << seq;
+}
+
+int cdcl_solve (cdcl_t *s, int *assumps, int n)
+{
+  int confl, restarts = 0, conflicts = 0, limit = 100, p, v, size, btlevel;
+
+  if (!s->ok) return 0;
+  backtrack(s,0);
+
+  for (;;)
+  {
+    if ((confl = propagate(s)) != UNDEF)
+    {
+      conflicts++;
+      if (!s->levels) { s->ok = 0; return 0; }
+      size = analyze(s,confl,&btlevel);
+      backtrack(s,btlevel);
+      if (size == 1)
+        enqueue(s,s->learnt[0],UNDEF);
+      else
+        enqueue(s,s->learnt[0],store(s,s->learnt,size));
+      continue;
+    }
+
+    if (conflicts >= limit)
+    {
+      conflicts = 0;
+      limit = 100 * luby(++restarts);
+      backtrack(s,0);
+      continue;
+    }
+
+    /* assumptions first, one decision level each */
+    p = UNDEF;
+    while (s->levels < n)
+    {
+      p = LIT(assumps[s->levels]);
+      if (lit_value(s,p) == 1)
+      {
+        s->trail_lim[s->levels++] = s->trail_size;
+        p = UNDEF;
+      }
+      else if (lit_value(s,p) == 0)
+      {
+        backtrack(s,0);
+        return 0;
+      }
+      else break;
+    }
+    while (p == UNDEF)
+    {
+      if (!s->heap_size)
+      { /* all variables are assigned: a model */
+        memcpy(s->model,s->val,s->nvars + 1);
+        backtrack(s,0);
+        return 1;
+      }
+      v = heap_pop(s);
+      if (s->val[v] == UNDEF) p = 2 * v + !s->phase[v];
+    }
+    s->trail_lim[s->levels++] = s->trail_size;
+    enqueue(s,p,UNDEF);
+  }
+}
+
+int cdcl_model (cdcl_t *s, int var)
+{
+  return s->model[var] == 1;
+}
@@ -0,0 +1,21 @@
+/****************************************************************************/
+/* cdcl.h								    */
+/*									    */
+/* A small incremental CDCL SAT solver, solving under assumptions. Used    */
+/* by mci2sat -t to check many targets against one encoding of a prefix.  */
+/* Variables are numbered from 1, literals are given in DIMACS style.      */
+/****************************************************************************/
+
+#ifndef __CDCL_H__
+#define __CDCL_H__
+
+typedef struct cdcl_t cdcl_t;
+
+extern cdcl_t* cdcl_new ();
+extern void cdcl_free (cdcl_t*);
+extern int cdcl_newvar (cdcl_t*);
+extern void cdcl_add (cdcl_t*,int*,int);
+extern int cdcl_solve (cdcl_t*,int*,int);
+extern int cdcl_model (cdcl_t*,int);
+
+#endif
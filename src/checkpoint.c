@@ -0,0 +1,513 @@
+/****************************************************************************/
+/* checkpoint.c								    */
+/*									    */
+/* Saving the state of the unfolding procedure (-checkpoint) and going on  */
+/* from a saved state (-resume). The file holds native integers: the     */
+/* conditions and events with their co-relation and Parikh vectors, the   */
+/* lists kept by unfold(), the queue of possible extensions in heap order, */
+/* the marking table slot by slot and the query cells. It is read back    */
+/* through mmap. The -cobits sets and the -mcmillan histories are not     */
+/* saved but rebuilt from the rest.					    */
+/****************************************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "netconv.h"
+#include "unfold.h"
+
+#define CKPT_MAGIC "\177MCK"
+#define CKPT_VERSION 1
+
+char *ckpt_file = NULL;    /* argument of -checkpoint */
+int ckpt_every = 0;        /* argument of -every */
+char *resume_file = NULL;  /* argument of -resume */
+
+static FILE *ckpt_out;
+static const char *ckpt_name;
+static const int *ckpt_pos, *ckpt_end;
+
+/*****************************************************************************/
+/* A signature of the net and of the options that change the prefix, so   */
+/* that a checkpoint is not resumed with another model.          */
+
+static unsigned int ckpt_mix (unsigned int h, const void *ptr, int len)
+{
+  const unsigned char *p = ptr;
+
+  while (len--) h = (h ^ *p++) * 16777619u;
+  return h;
+}
+
+static unsigned int ckpt_signature ()
+{
+  unsigned int h = 2166136261u;
+  int opts[] = { mcmillan, unfold_depth, m_repeat, freechk, confmax,
+                 stoptr ? stoptr->num : 0 };
+  char *strs[] = { badunf, qrmarking, rtplaces, bltransitions };
+  place_t *pl;
+  trans_t *tr;
+  int i;
+
+  for (pl = net->places; pl; pl = pl->next)
+    h = ckpt_mix(h,pl->name,strlen(pl->name)+1);
+  for (tr = net->transitions; tr; tr = tr->next)
+    h = ckpt_mix(h,tr->name,strlen(tr->name)+1);
+  h = ckpt_mix(h,opts,sizeof(opts));
+  for (i = 0; i < 4; i++)
+    h = strs[i] ? ckpt_mix(h,strs[i],strlen(strs[i])+1) : ckpt_mix(h,"",1);
+  return h;
+}
+
+/*****************************************************************************/
+/* Writing.                   */
+
+static void put (int v)
+{
+  fwrite(&v,sizeof(int),1,ckpt_out);
+}
+
+static void put_marking (marking_t *marking)
+{
+  fwrite(marking->bits,sizeof(unsigned long long),marking_words,ckpt_out);
+}
+
+static void put_pvector (parikh_t *pv)
+{
+  int n;
+
+  for (n = 1; pv[n-1].tr_num; n++);
+  put(n);
+  fwrite(pv,sizeof(parikh_t),n,ckpt_out);
+}
+
+/* A list of events or conditions, as their numbers plus one (0 for NULL). */
+
+static void put_evlist (nodelist_t *list)
+{
+  nodelist_t *l;
+  int n;
+
+  for (n = 0, l = list; l; l = l->next) n++;
+  put(n);
+  for (; list; list = list->next)
+    put(list->node ? ((event_t*) list->node)->num + 1 : 0);
+}
+
+static void put_colist (nodelist_t *list)
+{
+  nodelist_t *l;
+  int n;
+
+  for (n = 0, l = list; l; l = l->next) n++;
+  put(n);
+  for (; list; list = list->next)
+    put(list->node ? ((cond_t*) list->node)->num + 1 : 0);
+}
+
+static void put_coarray (coa_t *coa)
+{
+  int i;
+
+  put(coa->inuse);
+  for (i = 0; i < coa->inuse; i++) put(coa->conds[i]->num);
+}
+
+/* Save the state at the top of the main loop of unfold(). 'repeat' is the
+   only variable of the loop that is carried from one event to the next.
+   The file is written under a temporary name and then renamed, so that an
+   interrupted save leaves the previous checkpoint intact. */
+
+void checkpoint_save (int repeat, char *trans_pool)
+{
+  char *tmpname = MYmalloc(strlen(ckpt_file)+5);
+  char *live = MYcalloc(unf->numco + 1);
+  event_t **evs = MYmalloc((unf->numev + 1) * sizeof(event_t*));
+  cond_t **cos = MYmalloc((unf->numco + 1) * sizeof(cond_t*));
+  querycell_t *qbuck;
+  nodelist_t *list;
+  place_t *pl;
+  cond_t *co;
+  event_t *ev;
+  int i, n;
+
+  sprintf(tmpname,"%s.tmp",ckpt_file);
+  if (!(ckpt_out = fopen(tmpname,"wb")))
+    nc_error("cannot write to file %s",tmpname);
+  setvbuf(ckpt_out,NULL,_IOFBF,1 << 20);
+
+  /* unf->events only holds the events that are neither cutoffs nor
+     harmful, the conditions are all in unf->conditions; a condition has
+     a co-relation iff it has gone through pe() */
+  for (co = unf->conditions; co; co = co->next) cos[co->num] = co;
+  for (ev = unf->events; ev; ev = ev->next) evs[ev->num] = ev;
+  for (list = cutoff_list; list; list = list->next)
+    evs[((event_t*) list->node)->num] = list->node;
+  for (list = harmful_list; list; list = list->next)
+    evs[((event_t*) list->node)->num] = list->node;
+  for (pl = net->places; pl; pl = pl->next)
+    for (list = pl->conds; list; list = list->next)
+      live[((cond_t*) list->node)->num] = 1;
+
+  fwrite(CKPT_MAGIC,4,1,ckpt_out);
+  put(CKPT_VERSION);
+  put(ckpt_signature());
+  put(net->numpl);
+  put(net->numtr);
+  put(marking_words);
+  put(unf->numco);
+  put(unf->numev);
+  put(queue_count);
+  put(pe_stopped);
+  put(repeat);
+
+  for (i = 0; i < unf->numco; i++)
+  {
+    co = cos[i];
+    put(co->origin->num);
+    put(co->pre_ev ? co->pre_ev->num + 1 : 0);
+    put(co->token);
+    put(co->queried);
+    put(live[i]);
+    if (live[i]) put_coarray(&co->co_private);
+  }
+
+  for (i = 0; i < unf->numev; i++)
+  {
+    ev = evs[i];
+    put(ev->origin->num);
+    put(ev->id);
+    put(ev->queried);
+    put(ev->lc_size);
+    put(ev->foata_level);
+    for (n = 0; n < ev->preset_size; n++) put(ev->preset[n]->num);
+    for (n = 0; n < ev->postset_size; n++) put(ev->postset[n]->num);
+    put_pvector(ev->p_vector);
+    if (ev->postset_size && live[ev->postset[0]->num])
+      put_coarray(&ev->postset[0]->co_common);
+  }
+
+  for (n = 0, ev = unf->events; ev; ev = ev->next) n++;
+  put(n);
+  for (ev = unf->events; ev; ev = ev->next) put(ev->num + 1);
+  put_colist(unf->m0);
+  put_colist(unf->m0_unmarked);
+  for (i = 1; i <= net->numpl; i++)
+    for (pl = net->places; pl; pl = pl->next)
+      if (pl->num == i) put_colist(pl->conds);
+  put_evlist(cutoff_list);
+  put_evlist(corr_list);
+  put_evlist(harmful_list);
+
+  put(pe_qsize);
+  for (i = 1; i <= pe_qsize; i++)
+  {
+    pe_queue_t *qu = pe_queue[i];
+    put(qu->trans->num);
+    put(qu->id);
+    put(qu->lc_size);
+    for (n = 0; n < qu->trans->prereset_size; n++) put(qu->conds[n]->num);
+    put_pvector(qu->p_vector);
+    put_marking(qu->marking);
+  }
+
+  put(hash_buckets);
+  for (i = 0; i < hash_buckets; i++)
+  {
+    if (!hash[i]) { put(0); continue; }
+    put(hash[i]->repeat);
+    put_evlist(hash[i]->pre_evs);
+    put_marking(hash[i]->marking);
+  }
+
+  for (n = 0, qbuck = *query; qbuck; qbuck = qbuck->next) n++;
+  put(n);
+  for (qbuck = *query; qbuck; qbuck = qbuck->next)
+  {
+    put(qbuck->repeat);
+    put(qbuck->szcut);
+    put(qbuck->szevscut);
+    put_colist(qbuck->cut);
+    put_evlist(qbuck->evscut);
+  }
+
+  /* the names of the transitions fired so far, padded to an integer */
+  put(n = strlen(trans_pool));
+  fwrite(trans_pool,1,n,ckpt_out);
+  fwrite("\0\0\0",1,(sizeof(int) - n % sizeof(int)) % sizeof(int),ckpt_out);
+
+  if (fclose(ckpt_out) || rename(tmpname,ckpt_file))
+    nc_error("cannot write to file %s",ckpt_file);
+  if (verbose)
+    printf("Checkpoint with %d events written to %s\n",unf->numev,ckpt_file);
+  free(tmpname); free(live); free(evs); free(cos);
+}
+
+/*****************************************************************************/
+/* Reading.                   */
+
+static void ckpt_error (const char *msg)
+{
+  nc_error("%s: %s",ckpt_name,msg);
+}
+
+static int get ()
+{
+  if (ckpt_pos >= ckpt_end) ckpt_error("unexpected end of file");
+  return *ckpt_pos++;
+}
+
+static int get_range (int lo, int hi)
+{
+  int v = get();
+  if (v < lo || v > hi) ckpt_error("number out of range");
+  return v;
+}
+
+static const void* get_bytes (long size)
+{
+  const void *ptr = ckpt_pos;
+  long n = (size + sizeof(int) - 1) / sizeof(int);
+
+  if (ckpt_end - ckpt_pos < n) ckpt_error("unexpected end of file");
+  ckpt_pos += n;
+  return ptr;
+}
+
+static marking_t* get_marking ()
+{
+  marking_t *marking = marking_alloc();
+
+  memcpy(marking->bits,
+    get_bytes(marking_words * sizeof(unsigned long long)),
+    marking_words * sizeof(unsigned long long));
+  marking_hash(marking);
+  return marking;
+}
+
+static parikh_t* get_pvector ()
+{
+  int n = get_range(1,net->numtr + 1);
+  parikh_t *pv = arena_alloc(unf->arena,n * sizeof(parikh_t));
+
+  memcpy(pv,get_bytes(n * sizeof(parikh_t)),n * sizeof(parikh_t));
+  if (pv[n-1].tr_num) ckpt_error("bad Parikh vector");
+  return pv;
+}
+
+static nodelist_t* get_list (void *nodes, int num)
+{
+  nodelist_t *list = NULL, **tail = &list;
+  int n = get_range(0,ckpt_end - ckpt_pos);
+
+  while (n--)
+  {
+    *tail = nodelist_alloc();
+    (*tail)->node = ((void**) nodes)[get_range(0,num)];
+    (*tail)->next = NULL;
+    tail = &(*tail)->next;
+  }
+  return list;
+}
+
+static coa_t get_coarray (cond_t **cos)
+{
+  int n = get_range(0,unf->numco), i;
+  coa_t coa = alloc_coarray(n);
+
+  for (i = 0; i < n; i++) coa.conds[i] = cos[get_range(0,unf->numco-1)];
+  coa.conds[n] = NULL;
+  coa.inuse = n;
+  return coa;
+}
+
+/* Rebuild the state saved by checkpoint_save. unfold() has set up the
+   marking table, the queue and the Parikh vectors as for a new run. */
+
+void checkpoint_load (int *repeat, char *trans_pool)
+{
+  struct stat st;
+  void *map;
+  int fd, i, n, numco, numev;
+  place_t **pls, *pl;
+  trans_t **trs, *tr;
+  cond_t **cos, *co;
+  event_t **evs, *ev;
+  querycell_t *qbuck, **qtail;
+
+  ckpt_name = resume_file;
+  if ((fd = open(resume_file,O_RDONLY)) < 0 || fstat(fd,&st) ||
+      (map = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0)) == MAP_FAILED)
+    nc_error("cannot read file %s",resume_file);
+  close(fd);
+  ckpt_pos = (const int*) map;
+  ckpt_end = ckpt_pos + st.st_size / sizeof(int);
+
+  if (st.st_size < 4 || memcmp(map,CKPT_MAGIC,4))
+    ckpt_error("not a checkpoint file");
+  ckpt_pos++;
+  if (get() != CKPT_VERSION) ckpt_error("unknown version");
+  if ((unsigned int) get() != ckpt_signature() || get() != net->numpl ||
+      get() != net->numtr || get() != marking_words)
+    ckpt_error("written for another net or with other options");
+
+  pls = MYcalloc((net->numpl + 1) * sizeof(place_t*));
+  trs = MYcalloc((net->numtr + 1) * sizeof(trans_t*));
+  for (pl = net->places; pl; pl = pl->next) pls[pl->num] = pl;
+  for (tr = net->transitions; tr; tr = tr->next) trs[tr->num] = tr;
+
+  numco = get_range(0,ckpt_end - ckpt_pos);
+  numev = get_range(0,ckpt_end - ckpt_pos);
+  queue_count = get();
+  pe_stopped = get();
+  *repeat = get();
+
+  /* create all nodes first, the co-relation refers to later ones; in the
+     lists, 0 stands for NULL and n for the node numbered n-1 */
+  cos = (cond_t**) MYcalloc((numco + 1) * sizeof(cond_t*)) + 1;
+  evs = (event_t**) MYcalloc((numev + 1) * sizeof(event_t*)) + 1;
+  for (i = 0; i < numco; i++)
+  {
+    co = cos[i] = arena_alloc(unf->arena,sizeof(cond_t));
+    memset(co,0,sizeof(cond_t));
+    co->next = unf->conditions;
+    unf->conditions = co;
+    co->num = unf->numco++;
+    if (co_bitsets) cobits_new_condition(co);
+  }
+  for (i = 0; i < numev; i++)
+  {
+    ev = evs[i] = arena_alloc(unf->arena,sizeof(event_t));
+    memset(ev,0,sizeof(event_t));
+    ev->num = i;
+  }
+  unf->numev = numev;
+
+  for (i = 0; i < numco; i++)
+  {
+    co = cos[i];
+    co->origin = pls[get_range(1,net->numpl)];
+    co->pre_ev = (n = get_range(0,numev)) ? evs[n-1] : NULL;
+    co->token = get();
+    co->queried = get();
+    if (get())
+    {
+      co->co_private = get_coarray(cos);
+      if (co_bitsets)
+        for (n = 0; n < co->co_private.inuse; n++)
+          cobits_add_private(co,co->co_private.conds[n]);
+    }
+  }
+
+  for (i = 0; i < numev; i++)
+  {
+    ev = evs[i];
+    ev->origin = tr = trs[get_range(1,net->numtr)];
+    ev->id = get();
+    ev->queried = get();
+    ev->lc_size = get();
+    ev->foata_level = get();
+    ev->preset_size = tr->prereset_size;
+    ev->postset_size = tr->postreset_size;
+    ev->preset = arena_alloc(unf->arena,ev->preset_size * sizeof(cond_t*));
+    ev->postset = arena_alloc(unf->arena,ev->postset_size * sizeof(cond_t*));
+    for (n = 0; n < ev->preset_size; n++)
+    {
+      ev->preset[n] = cos[get_range(0,numco-1)];
+      nodelist_push(&(ev->preset[n]->postset),ev);
+    }
+    for (n = 0; n < ev->postset_size; n++)
+      ev->postset[n] = cos[get_range(0,numco-1)];
+    ev->p_vector = get_pvector();
+    if (mcmillan) ev->history = cobits_history(ev);
+
+    /* the common part of the co-relation, shared by the postset */
+    if (ev->postset_size && ev->postset[0]->co_private.conds)
+    {
+      coa_t common = get_coarray(cos);
+      cobits_t bits;
+      if (co_bitsets) bits = cobits_from_coarray(common);
+      for (n = 0; n < ev->postset_size; n++)
+      {
+        ev->postset[n]->co_common = common;
+        if (co_bitsets) cobits_common[ev->postset[n]->num] = bits;
+      }
+    }
+  }
+  /* the initial conditions have an empty common part */
+  for (i = 0; i < numco; i++)
+    if (!cos[i]->pre_ev && cos[i]->co_private.conds)
+      cos[i]->co_common = alloc_coarray(0);
+
+  for (n = get_range(0,numev), ev = NULL; n; n--)
+  {
+    event_t *e = evs[get_range(1,numev)-1];
+    if (ev) ev->next = e; else unf->events = e;
+    (ev = e)->next = NULL;
+  }
+  unf->m0 = get_list(cos-1,numco);
+  unf->m0_unmarked = get_list(cos-1,numco);
+  for (i = 1; i <= net->numpl; i++) pls[i]->conds = get_list(cos-1,numco);
+  cutoff_list = get_list(evs-1,numev);
+  corr_list = get_list(evs-1,numev);
+  harmful_list = get_list(evs-1,numev);
+
+  for (n = get_range(0,ckpt_end - ckpt_pos); n; n--)
+  {
+    pe_queue_t *qu = MYcalloc(sizeof(pe_queue_t));
+    qu->trans = tr = trs[get_range(1,net->numtr)];
+    qu->id = get();
+    qu->lc_size = get();
+    qu->conds = MYmalloc(tr->prereset_size * sizeof(cond_t*));
+    for (i = 0; i < tr->prereset_size; i++)
+      qu->conds[i] = cos[get_range(0,numco-1)];
+    qu->p_vector = get_pvector();
+    qu->marking = get_marking();
+    pe_append(qu);
+  }
+
+  /* the marking table, slot by slot */
+  n = get();
+  if (n < 16 || (n & (n-1))) ckpt_error("bad size of the marking table");
+  free(hash);
+  hash = MYcalloc((hash_buckets = n) * sizeof(hashcell_t*));
+  for (hash_count = i = 0; i < hash_buckets; i++)
+    if ((n = get()))
+    {
+      hash[i] = MYmalloc(sizeof(hashcell_t));
+      hash[i]->repeat = n;
+      hash[i]->pre_evs = get_list(evs-1,numev);
+      hash[i]->marking = get_marking();
+      hash_count++;
+    }
+
+  for (qtail = query, n = get_range(0,ckpt_end - ckpt_pos); n; n--)
+  {
+    qbuck = MYmalloc(sizeof(querycell_t));
+    qbuck->repeat = get();
+    qbuck->szcut = get();
+    qbuck->szevscut = get();
+    qbuck->cut = get_list(cos-1,numco);
+    qbuck->evscut = get_list(evs-1,numev);
+    qbuck->next = NULL;
+    *qtail = qbuck;
+    qtail = &qbuck->next;
+  }
+
+  n = get_range(0,(net->maxtrname+2) * net->numtr);
+  memcpy(trans_pool,get_bytes(n),n);
+  trans_pool[n] = 0;
+  if (ckpt_pos != ckpt_end) ckpt_error("trailing data");
+
+  if (verbose)
+    printf("Resuming with %d events and %d conditions from %s\n",
+      numev,numco,resume_file);
+  munmap(map,st.st_size);
+  free(pls); free(trs); free(cos-1); free(evs-1);
+}
@@ -0,0 +1,372 @@
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "common.h"
+#include "unfold.h"
+
+/*****************************************************************************/
+/* Alternative representation of the co-relation (-cobits). Besides the    */
+/* co-arrays, every condition keeps its common and private co-conditions   */
+/* as chunked bitsets indexed by condition numbers: only the chunks of     */
+/* COBITS_CHUNK bits that contain some condition are stored, together with */
+/* their numbers in ascending order. co_relation then intersects the sets  */
+/* of the preset conditions chunk by chunk with vector instructions.     */
+
+int co_bitsets = 0;          /* whether -cobits has been supplied */
+
+cobits_t *cobits_common;     /* indexed by condition number */
+cobits_t *cobits_private;
+cond_t **cond_by_num;        /* to map set members back to conditions */
+int cobits_alloc;            /* size of the three arrays above */
+
+cobits_t cobits_result;      /* scratch set for cobits_intersect */
+cobits_t cobits_past[2];     /* scratch sets for cobits_history */
+cond_t **cobits_members;     /* its members, returned by cobits_intersect */
+int cobits_members_size;
+
+/*****************************************************************************/
+/* Word-wise r = r & (p | q); p or q may be NULL for an absent chunk.      */
+/* Returns non-zero iff the resulting chunk is not empty.        */
+
+int chunk_and_or_plain (cochunk_t *r, cochunk_t *p, cochunk_t *q)
+{
+  unsigned long long any = 0;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    any |= r->w[i] &= (p? p->w[i] : 0) | (q? q->w[i] : 0);
+  return any != 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse4.1")))
+int chunk_and_or_sse (cochunk_t *r, cochunk_t *p, cochunk_t *q)
+{
+  __m128i z = _mm_setzero_si128(), lo, hi;
+
+  lo = _mm_or_si128(p? _mm_loadu_si128((__m128i*)p->w) : z,
+                    q? _mm_loadu_si128((__m128i*)q->w) : z);
+  hi = _mm_or_si128(p? _mm_loadu_si128((__m128i*)(p->w+2)) : z,
+                    q? _mm_loadu_si128((__m128i*)(q->w+2)) : z);
+  lo = _mm_and_si128(lo,_mm_loadu_si128((__m128i*)r->w));
+  hi = _mm_and_si128(hi,_mm_loadu_si128((__m128i*)(r->w+2)));
+  _mm_storeu_si128((__m128i*)r->w,lo);
+  _mm_storeu_si128((__m128i*)(r->w+2),hi);
+  lo = _mm_or_si128(lo,hi);
+  return !_mm_testz_si128(lo,lo);
+}
+
+__attribute__((target("avx2")))
+int chunk_and_or_avx2 (cochunk_t *r, cochunk_t *p, cochunk_t *q)
+{
+  __m256i z = _mm256_setzero_si256(), v;
+
+  v = _mm256_or_si256(p? _mm256_loadu_si256((__m256i*)p->w) : z,
+                      q? _mm256_loadu_si256((__m256i*)q->w) : z);
+  v = _mm256_and_si256(v,_mm256_loadu_si256((__m256i*)r->w));
+  _mm256_storeu_si256((__m256i*)r->w,v);
+  return !_mm256_testz_si256(v,v);
+}
+
+#endif
+
+int (*chunk_and_or) (cochunk_t*, cochunk_t*, cochunk_t*) = chunk_and_or_plain;
+
+void cobits_init ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    chunk_and_or = chunk_and_or_avx2;
+  else if (__builtin_cpu_supports("sse4.1"))
+    chunk_and_or = chunk_and_or_sse;
+#endif
+  memset(&cobits_result,0,sizeof(cobits_t));
+}
+
+void cobits_finish ()
+{
+  free(cobits_common);
+  free(cobits_private);
+  free(cond_by_num);
+  free(cobits_result.index);
+  free(cobits_result.chunks);
+  free(cobits_members);
+  cobits_members = NULL;
+  cobits_members_size = 0;
+  cobits_common = cobits_private = NULL;
+  cond_by_num = NULL;
+  cobits_alloc = 0;
+}
+
+/*****************************************************************************/
+/* Register a new condition: its sets start out empty.        */
+
+void cobits_new_condition (cond_t *co)
+{
+  if (co->num >= cobits_alloc)
+  {
+    int size = 2 * cobits_alloc + 1024;
+    cobits_common = MYrealloc(cobits_common,size * sizeof(cobits_t));
+    cobits_private = MYrealloc(cobits_private,size * sizeof(cobits_t));
+    cond_by_num = MYrealloc(cond_by_num,size * sizeof(cond_t*));
+    cobits_alloc = size;
+  }
+  memset(cobits_common + co->num,0,sizeof(cobits_t));
+  memset(cobits_private + co->num,0,sizeof(cobits_t));
+  cond_by_num[co->num] = co;
+}
+
+/*****************************************************************************/
+/* Make room for one more chunk. Sets of the unfolding live in the arena;  */
+/* the old space of a grown set is simply left behind.         */
+
+void cobits_grow (cobits_t *set)
+{
+  int size = set->size * 2 + 4;
+  int *index = arena_alloc(unf->arena,size * sizeof(int));
+  cochunk_t *chunks = arena_alloc(unf->arena,size * sizeof(cochunk_t));
+
+  memcpy(index,set->index,set->inuse * sizeof(int));
+  memcpy(chunks,set->chunks,set->inuse * sizeof(cochunk_t));
+  set->index = index;
+  set->chunks = chunks;
+  set->size = size;
+}
+
+/* Add condition number num to the set. Numbers usually come in increasing */
+/* order, so the new chunk (if any) is normally appended at the end.      */
+
+void cobits_add (cobits_t *set, int num)
+{
+  int k = num / COBITS_CHUNK, pos = set->inuse, lo, hi;
+
+  if (pos && set->index[pos-1] >= k)
+  { /* binary search for the chunk */
+    for (lo = 0, hi = pos; lo < hi; )
+      if (set->index[(lo+hi)/2] < k) lo = (lo+hi)/2 + 1; else hi = (lo+hi)/2;
+    pos = lo;
+  }
+  if (pos == set->inuse || set->index[pos] != k)
+  {
+    if (set->inuse == set->size) cobits_grow(set);
+    memmove(set->index+pos+1,set->index+pos,(set->inuse-pos) * sizeof(int));
+    memmove(set->chunks+pos+1,set->chunks+pos,
+      (set->inuse-pos) * sizeof(cochunk_t));
+    set->index[pos] = k;
+    memset(set->chunks+pos,0,sizeof(cochunk_t));
+    set->inuse++;
+  }
+  set->chunks[pos].w[(num % COBITS_CHUNK) / 64] |= 1ULL << (num % 64);
+}
+
+/* Whether num is in the set. */
+
+int cobits_test (cobits_t *set, int num)
+{
+  int k = num / COBITS_CHUNK, lo = 0, hi = set->inuse, mid;
+
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if (set->index[mid] < k) lo = mid + 1; else hi = mid;
+  }
+  return lo < set->inuse && set->index[lo] == k &&
+    (set->chunks[lo].w[(num % COBITS_CHUNK) / 64] >> (num % 64) & 1);
+}
+
+/* Record that a and b are concurrent, via their private sets. */
+
+void cobits_add_private (cond_t *a, cond_t *b)
+{
+  cobits_add(cobits_private + a->num,b->num);
+}
+
+/* The common set shared by the postset of an event, built from its array. */
+
+cobits_t cobits_from_coarray (coa_t coa)
+{
+  cobits_t set;
+  cond_t **co_ptr;
+
+  memset(&set,0,sizeof(cobits_t));
+  for (co_ptr = coa.conds; *co_ptr; co_ptr++)
+    cobits_add(&set,(*co_ptr)->num);
+  return set;
+}
+
+/*****************************************************************************/
+/* Compute the conditions concurrent to all n conditions of the preset,    */
+/* i.e. the intersection of the unions of their common and private sets,   */
+/* and return them in increasing order (terminated by NULL) in 'out'.     */
+/* Returns the number of conditions found.        */
+
+int cobits_intersect (cond_t **preset, int n, cond_t ***out)
+{
+  cobits_t *res = &cobits_result, *c, *p;
+  int i, first = 0, best = -1, size, j, ic, ip, count = 0, w;
+  unsigned long long word;
+
+  /* start with the smallest of the sets */
+  for (i = 0; i < n; i++)
+  {
+    size = cobits_common[preset[i]->num].inuse
+      + cobits_private[preset[i]->num].inuse;
+    if (best < 0 || size < best) { best = size; first = i; }
+  }
+  if (best > res->size)
+  {
+    res->size = best;
+    res->index = MYrealloc(res->index,best * sizeof(int));
+    res->chunks = MYrealloc(res->chunks,best * sizeof(cochunk_t));
+  }
+
+  /* the union of the two sets of the first condition */
+  c = cobits_common + preset[first]->num;
+  p = cobits_private + preset[first]->num;
+  for (res->inuse = ic = ip = 0; ic < c->inuse || ip < p->inuse; )
+    if (ip == p->inuse || (ic < c->inuse && c->index[ic] < p->index[ip]))
+    {
+      res->index[res->inuse] = c->index[ic];
+      res->chunks[res->inuse++] = c->chunks[ic++];
+    }
+    else if (ic == c->inuse || p->index[ip] < c->index[ic])
+    {
+      res->index[res->inuse] = p->index[ip];
+      res->chunks[res->inuse++] = p->chunks[ip++];
+    }
+    else
+    {
+      res->index[res->inuse] = c->index[ic];
+      res->chunks[res->inuse] = c->chunks[ic++];
+      for (w = 0; w < 4; w++)
+        res->chunks[res->inuse].w[w] |= p->chunks[ip].w[w];
+      res->inuse++, ip++;
+    }
+
+  /* intersect with the others, dropping chunks that become empty */
+  for (i = 0; i < n && res->inuse; i++)
+  {
+    if (i == first) continue;
+    c = cobits_common + preset[i]->num;
+    p = cobits_private + preset[i]->num;
+    for (size = j = ic = ip = 0; j < res->inuse; j++)
+    {
+      int k = res->index[j];
+      while (ic < c->inuse && c->index[ic] < k) ic++;
+      while (ip < p->inuse && p->index[ip] < k) ip++;
+      if (!chunk_and_or(res->chunks + j,
+            ic < c->inuse && c->index[ic] == k ? c->chunks + ic : NULL,
+            ip < p->inuse && p->index[ip] == k ? p->chunks + ip : NULL))
+        continue;
+      res->index[size] = k;
+      res->chunks[size++] = res->chunks[j];
+    }
+    res->inuse = size;
+  }
+
+  /* translate the members back into conditions */
+  for (j = 0; j < res->inuse; j++)
+    for (w = 0; w < 4; w++)
+      count += __builtin_popcountll(res->chunks[j].w[w]);
+  if (count >= cobits_members_size)
+  {
+    cobits_members_size = count + 1;
+    cobits_members = MYrealloc(cobits_members,
+      cobits_members_size * sizeof(cond_t*));
+  }
+  for (count = j = 0; j < res->inuse; j++)
+    for (w = 0; w < 4; w++)
+      for (word = res->chunks[j].w[w]; word; word &= word - 1)
+        cobits_members[count++] = cond_by_num[res->index[j] * COBITS_CHUNK
+          + w * 64 + __builtin_ctzll(word)];
+  cobits_members[count] = NULL;
+
+  *out = cobits_members;
+  return count;
+}
+
+/*****************************************************************************/
+/* dst = a | b, where dst is a scratch set with malloc'ed storage.      */
+
+void cobits_union (cobits_t *dst, cobits_t *a, cobits_t *b)
+{
+  int ia = 0, ib = 0, w;
+
+  if (a->inuse + b->inuse > dst->size)
+  {
+    dst->size = 2 * (a->inuse + b->inuse);
+    dst->index = MYrealloc(dst->index,dst->size * sizeof(int));
+    dst->chunks = MYrealloc(dst->chunks,dst->size * sizeof(cochunk_t));
+  }
+  for (dst->inuse = 0; ia < a->inuse || ib < b->inuse; dst->inuse++)
+    if (ib == b->inuse || (ia < a->inuse && a->index[ia] < b->index[ib]))
+    {
+      dst->index[dst->inuse] = a->index[ia];
+      dst->chunks[dst->inuse] = a->chunks[ia++];
+    }
+    else if (ia == a->inuse || b->index[ib] < a->index[ia])
+    {
+      dst->index[dst->inuse] = b->index[ib];
+      dst->chunks[dst->inuse] = b->chunks[ib++];
+    }
+    else
+    {
+      dst->index[dst->inuse] = a->index[ia];
+      for (w = 0; w < COBITS_CHUNK/64; w++)
+        dst->chunks[dst->inuse].w[w] = a->chunks[ia].w[w] | b->chunks[ib].w[w];
+      ia++, ib++;
+    }
+}
+
+/*****************************************************************************/
+/* The causal past of ev as a set of event numbers: the events that        */
+/* produced its preset together with their own pasts. Allocated from the   */
+/* arena, used by check_back to decide causality without a traversal.     */
+
+cobits_t* cobits_history (event_t *ev)
+{
+  cobits_t *acc = cobits_past, *tmp = cobits_past + 1, single;
+  cobits_t *history = arena_alloc(unf->arena,sizeof(cobits_t));
+  cochunk_t chunk;
+  event_t *pre;
+  int i, k;
+
+  acc->inuse = 0;
+  single.size = single.inuse = 1;
+  single.index = &k;
+  single.chunks = &chunk;
+  for (i = 0; i < ev->preset_size; i++)
+  {
+    if (!(pre = ev->preset[i]->pre_ev)) continue;
+
+    k = pre->num / COBITS_CHUNK;
+    memset(&chunk,0,sizeof(cochunk_t));
+    chunk.w[(pre->num % COBITS_CHUNK) / 64] = 1ULL << (pre->num % 64);
+    cobits_union(tmp,acc,&single);
+    cobits_union(acc,tmp,pre->history);
+  }
+
+  history->size = history->inuse = acc->inuse;
+  history->index = arena_alloc(unf->arena,acc->inuse * sizeof(int));
+  history->chunks = arena_alloc(unf->arena,acc->inuse * sizeof(cochunk_t));
+  memcpy(history->index,acc->index,acc->inuse * sizeof(int));
+  memcpy(history->chunks,acc->chunks,acc->inuse * sizeof(cochunk_t));
+  return history;
+}
+
+/* Release the scratch sets of cobits_history; the histories themselves
+   go with the arena. Needed with -mcmillan whether or not -cobits is on. */
+
+void cobits_history_finish ()
+{
+  free(cobits_past[0].index);
+  free(cobits_past[0].chunks);
+  free(cobits_past[1].index);
+  free(cobits_past[1].chunks);
+  memset(cobits_past,0,sizeof(cobits_past));
+}
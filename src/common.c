@@ -8,6 +8,17 @@
 
 #include "common.h"
 
+/****************************************************************************/
+/* wall_time: seconds elapsed since some fixed point, for timing.	    */
+
+double wall_time ()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 /****************************************************************************/
 /* nc_error								    */
 /* Outputs an error message to stderr and exits.			    */
@@ -144,3 +155,57 @@ char* MYstrdup(char *string)
   if (!(str = strdup(string))) nc_error("MYstrdup memory allocation rejected!");
   return str;
 }
+
+
+/****************************************************************************/
+/* Arena allocation. Memory is grabbed in blocks of ARENA_BLOCK bytes and   */
+/* handed out sequentially; requests larger than a quarter block get a     */
+/* block of their own. Everything is released by arena_free.               */
+
+#define ARENA_BLOCK (1 << 20)
+
+typedef struct arena_block_t
+{
+  struct arena_block_t *next;
+  size_t pad;   /* keeps the data 16-byte aligned */
+} arena_block_t;
+
+arena_t* arena_create ()
+{
+  return MYcalloc(sizeof(arena_t));
+}
+
+void* arena_alloc (arena_t *arena, size_t size)
+{
+  arena_block_t *block;
+  void *m;
+
+  size = (size + 15) & ~(size_t)15;
+  if (size > arena->left)
+  {
+    size_t bsize = size > ARENA_BLOCK/4 ? size : ARENA_BLOCK;
+    block = MYmalloc(sizeof(arena_block_t) + bsize);
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->total += bsize;
+    if (bsize != ARENA_BLOCK) return block + 1;
+    arena->ptr = (char*)(block + 1);
+    arena->left = bsize;
+  }
+  m = arena->ptr;
+  arena->ptr += size;
+  arena->left -= size;
+  return m;
+}
+
+void arena_free (arena_t *arena)
+{
+  arena_block_t *block;
+
+  while ((block = arena->blocks))
+  {
+    arena->blocks = block->next;
+    free(block);
+  }
+  free(arena);
+}
\ No newline at end of file
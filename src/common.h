@@ -19,6 +19,22 @@ extern void* MYrealloc(void*,size_t);
 extern char* MYstrdup(char*);
 extern void nc_error (const char*,...);
 extern void nc_warning (const char*,...);
+extern double wall_time ();
+/* A memory arena: blocks of memory from which objects are cut
+   sequentially and which are only released all at once. */
+
+typedef struct arena_t
+{
+  struct arena_block_t *blocks;  /* list of allocated blocks */
+  char *ptr;    /* next free byte in the current block */
+  size_t left;  /* free bytes in the current block */
+  size_t total; /* total number of bytes allocated */
+} arena_t;
+
+extern arena_t* arena_create ();
+extern void* arena_alloc (arena_t*,size_t);
+extern void arena_free (arena_t*);
+
 int strtoint(char*);
 char* ftokstr(char *, int, char);
 char* ltokstr(char *, int, char);
@@ -24,14 +24,31 @@ void usage(char *myname)
   "      -confmax         when used, it will enable interactive mode to display maximal configurations only.\n"
   "      -freechk         used to check freeness. When used, you should enable -badchk <badunf> to\n                       do a proper freeness check, otherwise you will have the initial prefix.\n                       The parameter will enable -mcmillan flag as well.\n                       It cannot be used with -T <name> option.\n"
   "      -badchk <badunf> used to check badness <badunf> is a mci file containing an unfolding\n                       prefix of the corresponding bad net.\n"
+  "      -badcache <file> keep the verdicts of -badchk in <file> and reuse them in later runs.\n"
   "      -verbose         if used, Ecofolder will print information concerning the prefix produced.\n"
   "      -q --query <marking>    query a marking in the prefix given by <marking>.\n"
   "      -rst --restriction <places>    restrict <places> from appearing in the unfolding, they must be comma-separated.\n"
   "      -blc --block <transitions>    block <transitions> from firing in the unfolding, they must be comma-separated.\n"
-  "      -useids         when used, Ecofolder will use ids for places and transitions given in\n                       the input file.\n\n"
+  "      -useids         when used, Ecofolder will use ids for places and transitions given in\n                       the input file.\n"
+  "      -loadfactor <f>  maximal load factor of the marking hash table, between 0.1 and 0.95\n                       (default 0.75).\n"
+  "      -stats           print statistics about the unfolding procedure.\n"
+  "      -stats-json <file>  write counters and timers of the procedure to <file> as JSON.\n"
+  "      -cobits          keep the co-relation as bitsets as well and intersect those.\n"
+  "      -j <threads>     search for possible extensions with <threads> threads.\n"
+  "      -timeout <s>     stop after <s> seconds of unfolding.\n"
+  "      -max-events <n>  stop when the prefix has <n> events.\n"
+  "      -max-mem <MB>    stop when the resident memory exceeds <MB> megabytes.\n"
+  "                       A run stopped by one of these limits writes the prefix built so far,\n"
+  "                       marked incomplete, and exits with code 2.\n\n"
 
   "     FileOptions:\n"
-  "      -m <filename>  file to store the unfolding in\n\n"
+  "      -m <filename>  file to store the unfolding in\n"
+  "      -mciv2         write the unfolding in the packed .mci format (version 2)\n"
+  "      -stream        write the unfolding to the file while it is computed\n"
+  "                     (plain .mci format only, not with -mciv2 or -c)\n"
+  "      -checkpoint <file> -every <n>  save the state of the procedure to <file>\n"
+  "                     every <n> events\n"
+  "      -resume <file> go on from the state saved in <file>\n\n"
 
   "Unless specified otherwise, all filenames will default to\n"
   "the basename of <LLnetfile> plus appropriate extensions.\n\n"
@@ -45,7 +62,7 @@ void usage(char *myname)
 
 int main (int argc, char **argv)
 {
-  int  i, given_name = 0;
+  int  i, given_name = 0, print_stats = 0;
   char    *llnet = NULL, *mcifile;
   char    **dptr = &llnet;
   char	*tmpname, *idx;
@@ -84,11 +101,76 @@ int main (int argc, char **argv)
       verbose = 1;
     else if (!strcmp(argv[i],"-useids"))
       useids = 1;
+    else if (!strcmp(argv[i],"-stats"))
+      stats = print_stats = 1;
+    else if (!strcmp(argv[i],"-stats-json"))
+    {
+      if (++i == argc) usage(argv[0]);
+      stats_json = argv[i];
+      stats = 1;
+    }
+    else if (!strcmp(argv[i],"-loadfactor"))
+    {
+      if (++i == argc) usage(argv[0]);
+      hash_load = atof(argv[i]);
+      if (hash_load < 0.1 || hash_load > 0.95) usage(argv[0]);
+    }
+    else if (!strcmp(argv[i],"-cobits"))
+      co_bitsets = 1;
+    else if (!strcmp(argv[i],"-mciv2"))
+      mciv2 = 1;
+    else if (!strcmp(argv[i],"-stream"))
+      mcistream = 1;
+    else if (!strcmp(argv[i],"-checkpoint"))
+    {
+      if (++i == argc) usage(argv[0]);
+      ckpt_file = argv[i];
+    }
+    else if (!strcmp(argv[i],"-every"))
+    {
+      if (++i == argc) usage(argv[0]);
+      ckpt_every = atoi(argv[i]);
+      if (ckpt_every < 1) usage(argv[0]);
+    }
+    else if (!strcmp(argv[i],"-resume"))
+    {
+      if (++i == argc) usage(argv[0]);
+      resume_file = argv[i];
+    }
+    else if (!strcmp(argv[i],"-timeout"))
+    {
+      if (++i == argc) usage(argv[0]);
+      max_time = atof(argv[i]);
+      if (max_time <= 0) usage(argv[0]);
+    }
+    else if (!strcmp(argv[i],"-max-events"))
+    {
+      if (++i == argc) usage(argv[0]);
+      max_events = atoi(argv[i]);
+      if (max_events < 1) usage(argv[0]);
+    }
+    else if (!strcmp(argv[i],"-max-mem"))
+    {
+      if (++i == argc) usage(argv[0]);
+      max_mem = atof(argv[i]) * 1024;
+      if (max_mem < 1) usage(argv[0]);
+    }
+    else if (!strcmp(argv[i],"-j"))
+    {
+      if (++i == argc) usage(argv[0]);
+      pe_threads = atoi(argv[i]);
+      if (pe_threads < 1) usage(argv[0]);
+    }
     else if (!strcmp(argv[i],"-badchk"))
     {
       if (++i == argc) usage(argv[0]);
       badunf = argv[i];
     }
+    else if (!strcmp(argv[i],"-badcache"))
+    {
+      if (++i == argc) usage(argv[0]);
+      badcache = argv[i];
+    }
     else if (!strcmp(argv[i],"-q") || !strcmp(argv[i],"--query"))
     {
       if (++i == argc) usage(argv[0]);
@@ -135,6 +217,12 @@ int main (int argc, char **argv)
     if(interactive || confmax) 
       usage(argv[0]); */
   if (stoptr_name && freechk) usage(argv[0]);
+  if (mcistream && (compressed || mciv2))
+    nc_error("-stream writes the plain .mci format and cannot be used with %s",
+      mciv2 ? "-mciv2" : "-c");
+  if (!ckpt_file != !ckpt_every) usage(argv[0]);
+  if ((ckpt_file || resume_file) && interactive) usage(argv[0]);
+  if (resume_file && mcistream) usage(argv[0]);
   
   net = read_pep_net(llnet);
 
@@ -276,6 +364,7 @@ int main (int argc, char **argv)
     printf("\n");
   }
 
+  if (mcistream) mci_stream_open(mcifile);
   unfold();
   nc_create_ignored_trans(net);
 
@@ -287,10 +376,29 @@ int main (int argc, char **argv)
   }
   if (compressed)
     write_mci_file_cpr(mcifile);
-  else
+  else if (!mcistream)
     write_mci_file(mcifile);
+  if (budget_hit)
+    nc_warning("%s limit reached, the prefix is incomplete: %d events "
+      "(%d cut-offs), %d possible extensions left",
+      budget_hit == BUDGET_TIME ? "time" :
+      budget_hit == BUDGET_EVENTS ? "event" : "memory",
+      unf->numev, nodelist_size(cutoff_list), budget_pending);
   
   
+  if (stats_json) stats_write(stats_json,llnet);
+  if (print_stats)
+  {
+    marking_stats();
+    foata_stats();
+    co_relation_stats();
+    badness_stats();
+    memory_stats("with the unfolding");
+  }
+  release_unfolding();
+  if (print_stats)
+    memory_stats("after releasing the unfolding");
+
   if(badunf && freechk) printf("%d", exitcode);
-  return 0;
+  return budget_hit ? 2 : 0;
 }
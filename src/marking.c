@@ -5,38 +5,217 @@
 #include "netconv.h"
 #include "unfold.h"
 
+/* 
+  The markings are kept in an open-addressing hash table with 
+  Robin Hood probing: a cell that is closer to its home slot 
+  gives way to one that is further away, which keeps probe 
+  sequences short even at high load. The table has a power of 
+  two size and is doubled as soon as it gets filled beyond 
+  hash_load.
+*/
+
 hashcell_t **hash;
 querycell_t **query;
-int hash_buckets;
+int hash_buckets;   /* size of the table, a power of two */
+int hash_count;     /* number of stored markings */
+double hash_load = 0.75;  /* maximal load factor (-loadfactor) */
+int hash_resizes;
+long long hash_lookups, hash_probes;  /* for -stats */
+int hash_maxprobe;
+long add_marking_calls;   /* calls to add_marking and their time, */
+double add_marking_time;  /* for -stats */
 int *rep_marking;
+int marking_words;
+place_t **marking_places; /* places indexed by num-1 */
 
 
 /******************************************************/
 
 void marking_init ()
 {
-  hash_buckets = net->numpl*4 + 1;
+  place_t *pl;
+
+  for (hash_buckets = 16; hash_buckets < net->numpl*4; hash_buckets *= 2);
   hash = MYcalloc(hash_buckets * sizeof(hashcell_t*));
+  hash_count = hash_resizes = hash_maxprobe = 0;
+  hash_lookups = hash_probes = 0;
   query = MYcalloc(1 * sizeof(querycell_t*));
+
+  marking_words = (net->numpl + 63) / 64;
+  marking_places = MYmalloc(net->numpl * sizeof(place_t*));
+  for (pl = net->places; pl; pl = pl->next)
+    marking_places[pl->num-1] = pl;
+}
+
+/******************************************************/
+/* Allocate an empty marking.     */
+
+marking_t* marking_alloc ()
+{
+  return MYcalloc(sizeof(marking_t) +
+    marking_words * sizeof(unsigned long long));
+}
+
+void marking_set (marking_t *marking, place_t *pl)
+{
+  marking->bits[(pl->num-1) / 64] |= 1ULL << ((pl->num-1) % 64);
+}
+
+int marking_test (marking_t *marking, place_t *pl)
+{
+  return (marking->bits[(pl->num-1) / 64] >> ((pl->num-1) % 64)) & 1;
 }
 
 /******************************************************/
 /* 
-  Compute the hash value of a marking. TODO: Is this a 
-  good hash function?? If not, replace by something better.
-  Also, this might be the only place that really needs 
-  pl->num.
+  Compute the 64-bit hash value of a marking and store 
+  it in the marking. Must be called once the marking is 
+  complete and before it is looked up in the table.
 */
 
-int marking_hash (nodelist_t *marking)
+unsigned long long marking_hash (marking_t *marking)
 {
-  unsigned int val = 0, i = 0;
-  while (marking)
+  unsigned long long val = 0xcbf29ce484222325ULL;
+  int i;
+
+  for (i = 0; i < marking_words; i++)
   {
-    val += ((place_t*)(marking->node))->num * ++i;
-    marking = marking->next;
+    val ^= marking->bits[i];
+    val *= 0x9e3779b97f4a7c15ULL;
+    val ^= val >> 29;
   }
-  return val % hash_buckets;
+  val *= 0xbf58476d1ce4e5b9ULL;
+  val ^= val >> 32;
+  return marking->hash = val;
+}
+
+/******************************************************/
+/* 
+  Compare two markings; return 0 if equal, -1 or 1 
+  otherwise. The order (by hash, then by bits) is only 
+  meant to keep hash chains sorted.
+*/
+
+int marking_compare (marking_t *m1, marking_t *m2)
+{
+  int cmp;
+
+  if (m1->hash != m2->hash) return m1->hash < m2->hash ? -1 : 1;
+  cmp = memcmp(m1->bits, m2->bits,
+    marking_words * sizeof(unsigned long long));
+  return cmp < 0 ? -1 : cmp > 0;
+}
+
+/* Return the number of marked places. */
+
+int marking_size (marking_t *marking)
+{
+  int i, sz = 0;
+  for (i = 0; i < marking_words; i++)
+    sz += __builtin_popcountll(marking->bits[i]);
+  return sz;
+}
+
+/* Return 1 if every place of m1 is also in m2. */
+
+int marking_subset (marking_t *m1, marking_t *m2)
+{
+  int i;
+  for (i = 0; i < marking_words; i++)
+    if (m1->bits[i] & ~m2->bits[i]) return 0;
+  return 1;
+}
+
+/******************************************************/
+/* 
+  Convert a marking into a list of places, in decreasing
+  order of place numbers. This is the order nodelist_insert
+  gives for places allocated one after the other, but does
+  not depend on where the allocator put them.
+*/
+
+nodelist_t* marking_to_list (marking_t *marking)
+{
+  nodelist_t *list = NULL;
+  unsigned long long word;
+  int i;
+
+  if (!marking) return NULL;
+  for (i = 0; i < marking_words; i++)
+    for (word = marking->bits[i]; word; word &= word - 1)
+      nodelist_push(&list,
+        marking_places[i*64 + __builtin_ctzll(word)]);
+  return list;
+}
+
+/******************************************************/
+/* Distance of the cell in the given slot from its home slot. */
+
+int marking_distance (hashcell_t *cell, int slot)
+{
+  return (slot - (int)(cell->marking->hash & (hash_buckets-1)))
+    & (hash_buckets-1);
+}
+
+/******************************************************/
+/* Return the cell of the table holding marking, or NULL. */
+
+hashcell_t* marking_lookup (marking_t *marking)
+{
+  int slot = marking->hash & (hash_buckets-1), dist = 0;
+  hashcell_t *cell, *found = NULL;
+
+  while (!found && (cell = hash[slot]) &&
+      marking_distance(cell,slot) >= dist)
+  {
+    if (!marking_compare(marking,cell->marking))
+      found = cell;
+    else
+      slot = (slot+1) & (hash_buckets-1), dist++;
+  }
+
+  hash_lookups++;
+  hash_probes += dist + 1;
+  if (hash_maxprobe <= dist) hash_maxprobe = dist + 1;
+  return found;
+}
+
+/******************************************************/
+/* 
+  Put a new cell into the table, assuming that its marking 
+  is not yet present. Doubles the table when necessary.
+*/
+
+void marking_insert (hashcell_t *cell)
+{
+  hashcell_t *tmp, **oldhash;
+  int slot, dist, i, oldsize;
+
+  if (hash_count+1 > hash_buckets * hash_load)
+  {
+    oldhash = hash;
+    oldsize = hash_buckets;
+    hash_buckets *= 2;
+    hash = MYcalloc(hash_buckets * sizeof(hashcell_t*));
+    hash_count = 0;
+    hash_resizes++;
+    for (i = 0; i < oldsize; i++)
+      if (oldhash[i]) marking_insert(oldhash[i]);
+    free(oldhash);
+  }
+
+  slot = cell->marking->hash & (hash_buckets-1);
+  for (dist = 0; hash[slot]; dist++)
+  {
+    if (marking_distance(hash[slot],slot) < dist)
+    { /* take the place of the richer cell and move that one on */
+      tmp = hash[slot]; hash[slot] = cell; cell = tmp;
+      dist = marking_distance(cell,slot);
+    }
+    slot = (slot+1) & (hash_buckets-1);
+  }
+  hash[slot] = cell;
+  hash_count++;
 }
 
 /******************************************************/
@@ -50,23 +229,22 @@ int marking_hash (nodelist_t *marking)
   unchanged.
 */
 
-int find_marking (nodelist_t *marking, int m_query)
+int find_marking (marking_t *marking, int m_query)
 {
-  hashcell_t **buck = hash + marking_hash(marking);
-  int cmp = 2;
-  nodelist_t* list = NULL;
+  hashcell_t *cell = marking_lookup(marking);
+  int cmp = cell ? 0 : 2, i;
   int tmp_repeat = 0;
-
-  while (*buck && (cmp = nodelist_compare(marking,(*buck)->marking)) > 0)
-    buck = &((*buck)->next);
+  unsigned long long word;
 
   if (m_query && !cmp){
-    for(list = marking; list && !cmp; list = list->next)
-      if(!((place_t*)(list->node))->queried)  cmp = 1;
-    if(!cmp && (*buck)->repeat != m_repeat)
-      tmp_repeat = (*buck)->repeat*-1;
-    else if(!cmp && (*buck)->repeat == m_repeat)
-      tmp_repeat = (*buck)->repeat;
+    for(i = 0; i < marking_words && !cmp; i++)
+      for(word = marking->bits[i]; word && !cmp; word &= word - 1)
+        if(!marking_places[i*64 + __builtin_ctzll(word)]->queried)
+          cmp = 1;
+    if(!cmp && cell->repeat != m_repeat)
+      tmp_repeat = cell->repeat*-1;
+    else if(!cmp && cell->repeat == m_repeat)
+      tmp_repeat = cell->repeat;
   }
 
   return !cmp && m_query ? tmp_repeat : !cmp;
@@ -75,30 +253,21 @@ int find_marking (nodelist_t *marking, int m_query)
 /******************************************************/
 /* 
   Inspecting the cone of an event to see if its 
-  corresponding marking was seen before
+  corresponding marking was seen before: whether ev 
+  produced one of the conditions or lies in the causal 
+  past of an event that did. Uses the histories kept 
+  with the events under -mcmillan.
 */
 
 int check_back(cond_t **conds, int size, event_t *ev)
 {
-  int i, found = 0;
-  for(i = 0; i < size && !found; i++)
-  {
-    //printf("i: %d, co name: %s and num: %d\n", i, conds[i]->origin->name, conds[i]->num + 1);
-    if(conds[i]->pre_ev && ev &&
-      conds[i]->pre_ev->mark != ev_mark)
-      {
-        if(conds[i]->pre_ev == ev)
-          found = 1;
-        else
-        { 
-          //printf("conds[i]->pre_ev->preset, ev->id: %s, %d\n", conds[i]->pre_ev->origin->name, ev->id);
-          found = check_back(conds[i]->pre_ev->preset,
-            conds[i]->pre_ev->preset_size, ev);
-        }
-        conds[i]->pre_ev->mark = ev_mark;
-      }
-  }
-  return found;
+  int i;
+
+  for (i = 0; i < size; i++)
+    if (conds[i]->pre_ev && ev && (conds[i]->pre_ev == ev ||
+        cobits_test(conds[i]->pre_ev->history, ev->num)))
+      return 1;
+  return 0;
 }
 
 /******************************************************/
@@ -109,17 +278,14 @@ int check_back(cond_t **conds, int size, event_t *ev)
   events and return 0.
 */
 
-int add_marking (nodelist_t *marking, event_t *ev)
+int add_marking (marking_t *marking, event_t *ev)
 {
-  hashcell_t *newbuck;
-  hashcell_t **buck = hash + marking_hash(marking);
-  char cmp = 2;
+  double start = stats? wall_time() : 0;
+  hashcell_t *newbuck, *cell = marking_lookup(marking);
+  char cmp = cell ? 0 : 2;
   nodelist_t* list = NULL;
   int not_present = 0, checked_back = 0;
 
-  while (*buck && (cmp = nodelist_compare(marking,(*buck)->marking)) > 0)
-    buck = &((*buck)->next);
-  
   /* printf("\nhola\n");
   if(ev) printf("creating marking: %s, %d\n", ev->origin->name, ev->id);
   for(list = marking; list; list = list->next)
@@ -128,7 +294,7 @@ int add_marking (nodelist_t *marking, event_t *ev)
   
   if(!cmp && mcmillan) /* marking is already present */
   {
-    list = (*buck)->pre_evs;
+    list = cell->pre_evs;
     if(!list) /* initial marking */
     {
       checked_back = 1;
@@ -138,7 +304,6 @@ int add_marking (nodelist_t *marking, event_t *ev)
     else
       for(; list && !checked_back; list = list->next)
       {
-        ev_mark++;
         if ((checked_back = check_back(ev->preset, ev->preset_size,
           list->node)))
         {
@@ -147,23 +312,23 @@ int add_marking (nodelist_t *marking, event_t *ev)
         }
       }
     not_present = !checked_back;
-    (*buck)->repeat++;
-    /* printf("\nrepetition: %d\n", (*buck)->repeat);
+    cell->repeat++;
+    /* printf("\nrepetition: %d\n", cell->repeat);
     printf("chao\n"); */
     /* if initial marking has been seen then we're done. */
     /* All configurations start from the initial marking. */
-    if((*buck)->pre_evs) nodelist_push(&((*buck)->pre_evs),ev);
+    if(cell->pre_evs) nodelist_push(&(cell->pre_evs),ev);
   }
   else if (!cmp && !mcmillan)
   {
-    (*buck)->repeat++;
+    cell->repeat++;
     //nodelist_delete(marking);
     nodelist_push(&cutoff_list,ev);
-    if ((*buck)->pre_evs)
-      nodelist_push(&corr_list,((event_t*)((*buck)->pre_evs->node)));
+    if (cell->pre_evs)
+      nodelist_push(&corr_list,((event_t*)(cell->pre_evs->node)));
     else
       nodelist_push(&corr_list, NULL);
-    nodelist_push(&((*buck)->pre_evs),ev);
+    nodelist_push(&(cell->pre_evs),ev);
   }
 
   if(!!cmp) /* marking is not present */
@@ -175,32 +340,36 @@ int add_marking (nodelist_t *marking, event_t *ev)
     newbuck->repeat = 1;
     /* printf("\nrepetition: %d\n", newbuck->repeat);
     printf("chao\n"); */
-    newbuck->next = *buck;
-    *buck = newbuck;
+    marking_insert(newbuck);
     not_present = 1;
   }
+  if (stats)
+  {
+    add_marking_calls++;
+    add_marking_time += wall_time() - start;
+  }
   return not_present;
 }
 
 /******************************************************/
 /* Collect the initial marking.     */
 
-nodelist_t* retrieve_list (char* attribute)
+marking_t* retrieve_list (char* attribute)
 {
   place_t *pl;
-  nodelist_t *list = NULL;
+  marking_t *marking = marking_alloc();
 
   for (pl = net->places; pl; pl = pl->next)
     if (((!strcmp("marked",attribute) && pl->marked) !=
      (!strcmp("queried",attribute) && pl->queried)) !=
      (!strcmp("harmful",attribute) && pl->harmful))
-      nodelist_insert(&list,pl);
+      marking_set(marking,pl);
     else if (!strcmp("queried",attribute) && !pl->queried && qrmarking)
     {
       if(strstr(qrmarking,pl->name))
       {
         pl->queried = 1;
-        nodelist_insert(&list,pl);
+        marking_set(marking,pl);
       }
       else
       {
@@ -209,22 +378,35 @@ nodelist_t* retrieve_list (char* attribute)
         if(strstr(qrmarking,plname))
         {
           pl->queried = 1;
-          nodelist_insert(&list,pl);
+          marking_set(marking,pl);
         }
       }
     }
-      
 
-  return list;
+  marking_hash(marking);
+  return marking;
 }
 
 /******************************************************/
+/* Report the state of the marking table (-stats).     */
 
-void print_marking_pl (nodelist_t* list)
+void marking_stats ()
 {
-  if (!list) return;
-  printf("%s ",((place_t*)(list->node))->name);
-  print_marking_pl(list->next);
+  printf("Marking table: %d markings in %d slots, %d resize%s, "
+    "%.2f probes per lookup (max %d)\n", hash_count, hash_buckets,
+    hash_resizes, hash_resizes == 1 ? "" : "s",
+    hash_lookups ? (double)hash_probes / hash_lookups : 0.0,
+    hash_maxprobe);
+}
+
+/******************************************************/
+
+void print_marking_pl (marking_t* marking)
+{
+  nodelist_t *list, *head = marking_to_list(marking);
+  for (list = head; list; list = list->next)
+    printf("%s ",((place_t*)(list->node))->name);
+  nodelist_delete(head);
 }
 
 void print_marking_co (nodelist_t* list)
@@ -234,9 +416,11 @@ void print_marking_co (nodelist_t* list)
   print_marking_co(list->next);
 }
 
-char *mrk2str (nodelist_t* list)
+char *mrk2str (marking_t* marking)
 {
-  if (!list) return NULL;
+  nodelist_t *list, *head = marking_to_list(marking);
+  if (!head) return NULL;
+  list = head;
   char *str_marking = calloc((net->maxplname*(net->numpl-1)), sizeof(char));
   while(list)
   {
@@ -244,5 +428,6 @@ char *mrk2str (nodelist_t* list)
     list = list->next;
     if (list) strcat(str_marking, ",");
   }
+  nodelist_delete(head);
   return str_marking;
 }
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include "common.h"
 #include "netconv.h"
 #include "unfold.h"
+#include "mcipack.h"
+
+int mciv2 = 0;     /* write the packed format (-mciv2) */
+int mcistream = 0; /* write the file while unfolding (-stream) */
 
 void* reverse_list (void *ptr)
 {
@@ -20,9 +24,175 @@ void* reverse_list (void *ptr)
   return newlist;
 }
 
+/* With -mciv2 the plain file is fed to the packer as it is written,
+   which writes the sections to the file and the header at the end, see
+   mcipack.h. */
+
+FILE* mci_create (char *filename)
+{
+  FILE *file = fopen(filename,mciv2 ? "wb+" : "wb");
+
+  if (!file) nc_error("cannot write to file %s\n",filename);
+  if (mciv2) mci_pack_begin(file,compressed);
+  return file;
+}
+
+void mci_write (FILE *file, const void *ptr, int size)
+{
+  if (mciv2) mci_pack_write(ptr,size);
+  else fwrite(ptr,size,1,file);
+}
+
+void mci_close (FILE *file, char *filename)
+{
+  if (mciv2 && mci_pack_end())
+    nc_error("cannot pack %s: %s\n",filename,mci_pack_error);
+  if (fclose(file)) nc_error("cannot write to file %s\n",filename);
+}
+
+/* With -stream the file is written while unfolding: the names first,
+   then a record for every condition, event, cutoff and harmful event as
+   it is found, and the final values of the query flags at the end, see
+   mcipack.h. The readers rebuild the plain file from it. */
+
+static FILE *mci_stream;
+static char *mci_stream_name;
+
+static void stream_int (int v)
+{
+  fwrite(&v,sizeof(int),1,mci_stream);
+}
+
+/* The records are written unchecked; the error flag of the stream is
+   tested once per event and at the end, so that a full disk stops the
+   run early instead of leaving a truncated file behind. */
+static void stream_check ()
+{
+  if (ferror(mci_stream))
+    nc_error("cannot write to file %s\n",mci_stream_name);
+}
+
+void mci_stream_open (char *filename)
+{
+  place_t *pl;
+  trans_t *tr;
+
+  if (!(mci_stream = fopen(filename,"wb")))
+    nc_error("cannot write to file %s\n",filename);
+  mci_stream_name = filename;
+  setvbuf(mci_stream,NULL,_IOFBF,1 << 20);
+  fwrite(MCI_STREAM_MAGIC,4,1,mci_stream);
+  stream_int(MCI_STREAM_VERSION);
+  stream_int(net->numpl);
+  stream_int(net->numtr);
+  stream_int(net->maxplname >= net->maxtrname ?
+	     net->maxplname : net->maxtrname);
+
+  /* the names in the order of write_mci_file */
+  net->places = reverse_list(net->places);
+  for (pl = net->places; pl; pl = pl->next)
+  {
+    stream_int(pl->id);
+    fwrite(pl->name,strlen(pl->name)+1,1,mci_stream);
+  }
+  fwrite("",1,1,mci_stream);
+  net->places = reverse_list(net->places);
+  net->transitions = reverse_list(net->transitions);
+  for (tr = net->transitions; tr; tr = tr->next)
+  {
+    stream_int(tr->id);
+    fwrite(tr->name,strlen(tr->name)+1,1,mci_stream);
+  }
+  fwrite("",1,1,mci_stream);
+  net->transitions = reverse_list(net->transitions);
+}
+
+void mci_stream_condition (cond_t *co)
+{
+  stream_int(MCI_REC_CONDITION);
+  stream_int(co->origin->id);
+  stream_int(co->token);
+  stream_int(co->queried);
+  stream_int(co->pre_ev ? co->pre_ev->num + 1 : 0);
+}
+
+void mci_stream_event (event_t *ev)
+{
+  int i;
+
+  stream_int(MCI_REC_EVENT);
+  stream_int(ev->origin->id);
+  stream_int(ev->preset_size);
+  for (i = 0; i < ev->preset_size; i++)
+    stream_int(ev->preset[i]->num + 1);
+  stream_check();
+}
+
+void mci_stream_cutoff (event_t *ev, event_t *corr)
+{
+  stream_int(MCI_REC_CUTOFF);
+  stream_int(ev->num + 1);
+  stream_int(corr ? corr->num + 1 : 0);
+}
+
+void mci_stream_harmful (event_t *ev)
+{
+  stream_int(MCI_REC_HARMFUL);
+  stream_int(ev->num + 1);
+}
+
+void mci_stream_close (event_t *stopev)
+{
+  querycell_t *qbuck;
+  nodelist_t *list;
+  event_t *ev;
+  cond_t *co;
+  int n;
+
+  stream_int(MCI_REC_END);
+  stream_int(stopev ? stopev->num + 1 : 0);
+  for (n = 0, ev = unf->events; ev; ev = ev->next) n += !!ev->queried;
+  stream_int(n);
+  for (ev = unf->events; ev; ev = ev->next)
+    if (ev->queried) stream_int(ev->num + 1);
+  for (n = 0, co = unf->conditions; co; co = co->next) n += !!co->queried;
+  stream_int(n);
+  for (co = unf->conditions; co; co = co->next)
+    if (co->queried) stream_int(co->num + 1);
+
+  for (qbuck = *query; qbuck; qbuck = qbuck->next)
+  {
+    stream_int(qbuck->repeat);
+    stream_int(qbuck->szcut);
+    stream_int(qbuck->szevscut);
+    qbuck->cut = nodelist_reverse(qbuck->cut);
+    qbuck->evscut = nodelist_reverse(qbuck->evscut);
+    for (list = qbuck->cut; list; list = list->next)
+      if ((co = list->node)) stream_int(co->num + 1);
+    for (list = qbuck->evscut; list; list = list->next)
+      if ((ev = list->node)) stream_int(ev->num + 1);
+  }
+  stream_int(0);
+  if (budget_hit)
+  {
+    stream_int(budget_hit);
+    stream_int(budget_pending);
+  }
+  stream_int(0);
+
+  stream_check();
+  if (fclose(mci_stream))
+    nc_error("cannot write to file %s\n",mci_stream_name);
+  if (verbose)
+  {
+    printf("unf->numev: %d\n", unf->numev);
+    printf("unf->numco: %d\n", unf->numco);
+  }
+}
+
 void write_mci_file (char *filename)
 {
-  #define write_int(x) fwrite(&(x),sizeof(int),1,file)
+  #define write_int(x) mci_write(file,&(x),sizeof(int))
 
   FILE *file;
   place_t *pl;
@@ -32,9 +202,7 @@ void write_mci_file (char *filename)
   nodelist_t *list1, *list2;
   int ev_num = 0, sz = 0, null = 0, once = 0, tmp = 0;
 
-  if (!(file = fopen(filename,"wb")))
-    nc_error("cannot write to file %s\n",filename);
-
+  file = mci_create(filename);
 
   write_int(unf->numco);
   write_int(unf->numev);
@@ -126,6 +294,12 @@ void write_mci_file (char *filename)
       else		write_int(null);
   }
   write_int(null);
+  /* empty unless a budget cut the run short (-timeout etc.) */
+  if (budget_hit)
+  {
+    write_int(budget_hit);
+    write_int(budget_pending);
+  }
   write_int(null);
   write_int(net->numpl);
   write_int(net->numtr);
@@ -139,15 +313,15 @@ void write_mci_file (char *filename)
   for (pl = net->places; pl; pl = pl->next)
   {
     write_int(pl->id);
-    fwrite(pl->name,strlen(pl->name)+1,1,file);
+    mci_write(file,pl->name,strlen(pl->name)+1);
   }
-  fwrite("",1,1,file);
+  mci_write(file,"",1);
   for (tr = net->transitions; tr; tr = tr->next)
   {
     write_int(tr->id);
-    fwrite(tr->name,strlen(tr->name)+1,1,file);
+    mci_write(file,tr->name,strlen(tr->name)+1);
   }
-  fwrite("",1,1,file);
+  mci_write(file,"",1);
 
-  fclose(file);
+  mci_close(file,filename);
 }
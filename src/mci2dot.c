@@ -2,34 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-typedef struct cut_t
-{
-  int repeat;
-  int szcut, szevscut;
-  int *cut;
-  int *evscut;
-} cut_t;
-
-typedef struct clist_t
-{
-  int   idcond;
-  struct clist_t* next;
-} clist_t;
-
-typedef struct evprepost
-{
-  clist_t *preset;
-  clist_t *postset;
-  struct evprepost *next;
-} evprepost;
-
-clist_t* clist_add(clist_t** list, int idpl)
-{
-  clist_t* newco = malloc(sizeof(clist_t));
-  newco->idcond = idpl;
-  newco->next = *list;
-  return *list = newco;
-}
+#include "mciread.h"
 
 int strtoint(char *num) {
   int  i, len;
@@ -44,24 +17,15 @@ int strtoint(char *num) {
 
 int read_mci_file (char *mcifile, char *evcofile, int m_repeat, char* evname, int cutout, char* conf)
 {
-  #define read_int(x) fread(&(x),sizeof(int),1,mcif)
-
-  FILE *mcif, *evcof;
-  int nqure, nqure_, nquszcut, nquszevscut, szcuts, 
-    numco, numev, numpl, idpl, idtr, numtr, sz, i, j, value;
-  int pre_ev, post_ev, cutoff, harmful, dummy = 0;
-  int *co2pl, *ev2tr, *tokens, *cut0, *queries_co,
-   *queries_ev, *cutoffs, *harmfuls, *queries_coset;
-  char **plname, **trname, *c;
-  cut_t **cuts;
-  evprepost **evprps;
-
-
-  if (!(mcif = fopen(mcifile,"rb")))
-  {
-    fprintf(stderr,"cannot read file %s\n",mcifile);
-    exit(1);
-  }
+  FILE *evcof;
+  mci_t *mci = mci_read(mcifile,0);
+  int numco = mci->numco, numev = mci->numev, numpl = mci->numpl,
+    sz = mci->maxname, szcuts = mci->numcuts+1, i, j, k, value;
+  int pre_ev, post_ev, dummy = 0;
+  int *co2pl = mci->co2pl, *ev2tr = mci->ev2tr, *tokens = mci->co_token,
+    *cut0, *queries_co, *queries_ev, *cutoffs, *harmfuls, *queries_coset;
+  char **plname = mci->plname, **trname = mci->trname;
+  mci_cut_t **cuts = mci->cuts, *qcut;
 
   if (evcofile)
   {
@@ -75,50 +39,18 @@ int read_mci_file (char *mcifile, char *evcofile, int m_repeat, char* evname, in
   if(!evname && !conf) 
     printf("digraph test {\n");
 
-
-  read_int(numco);
-  read_int(numev);
-
-  co2pl = malloc((numco+1) * sizeof(int));
-  tokens = malloc((numco+1) * sizeof(int));
   cut0 = calloc(numco+1, sizeof(int));
-  queries_co = malloc((numco+1) * sizeof(int));
-  queries_ev = malloc((numev+1) * sizeof(int));
-  queries_coset = malloc((numco+1) * sizeof(int));
-  ev2tr = malloc((numev+1) * sizeof(int));
+  queries_co = calloc(numco+1, sizeof(int));
+  queries_ev = calloc(numev+1, sizeof(int));
+  queries_coset = calloc(numco+1, sizeof(int));
   cutoffs = calloc(numev+1, sizeof(int));
   harmfuls = calloc(numev+1, sizeof(int));
-  evprps = calloc(numev+1, sizeof(evprepost*));
-  for (i = 0; i <= numev; i++) {
-    evprps[i] = malloc(sizeof(evprepost));
-    evprps[i]->preset = NULL;
-    evprps[i]->postset = NULL;
-  }
 
-  read_int(nqure);
-  nqure_ = abs(nqure);
-  cuts = calloc((szcuts = nqure_+1), sizeof(cut_t*));
-  if(nqure_ && !m_repeat)
-    dummy = nqure_;
-  else if(nqure_ && (m_repeat > szcuts-1 || m_repeat < 0))
+  if(szcuts > 1 && !m_repeat)
+    dummy = szcuts-1;
+  else if(szcuts > 1 && (m_repeat > szcuts-1 || m_repeat < 0))
     m_repeat = -1;
-  while(nqure_)
-  {
-    read_int(nquszcut);
-    read_int(nquszevscut);
-    cuts[nqure_] = malloc(sizeof(cut_t));
-    cuts[nqure_]->repeat = nqure;
-    cuts[nqure_]->szcut = nquszcut;
-    cuts[nqure_]->szevscut = nquszevscut;
-    cuts[nqure_]->cut = calloc(nquszcut+1, sizeof(int));
-    cuts[nqure_]->evscut = calloc(nquszevscut+1, sizeof(int));
-    for (i = 1; i <= nquszcut; i++)
-      read_int(cuts[nqure_]->cut[i]);
-    for (i = 1; i <= nquszevscut; i++)
-      read_int(cuts[nqure_]->evscut[i]);
-    read_int(nqure);
-    nqure_ = abs(nqure);
-  }
+  qcut = m_repeat > 0 && m_repeat < szcuts ? cuts[m_repeat] : NULL;
 
   if(evcofile)
   {  
@@ -134,39 +66,34 @@ int read_mci_file (char *mcifile, char *evcofile, int m_repeat, char* evname, in
       }
     }
   }
-  else if (m_repeat > 0 && cuts[m_repeat] && cuts[m_repeat]->repeat < 0)
+  else if (qcut && qcut->repeat < 0)
   {
-    for (i = 1; i <= cuts[m_repeat]->szcut; i++)
-      queries_co[cuts[m_repeat]->cut[i]] = 1;
-    for (i = 1; i <= cuts[m_repeat]->szevscut; i++)
-      queries_ev[cuts[m_repeat]->evscut[i]] = 1;
+    for (i = 0; i < qcut->szcut; i++)
+      queries_co[qcut->cut[i]] = 1;
+    for (i = 0; i < qcut->szevscut; i++)
+      queries_ev[qcut->evscut[i]] = 1;
   }
   else if (!m_repeat)
   {
     for (j = 1; j <= dummy; j++)
     {
-      for (i = 1; i <= cuts[j]->szcut; i++)
+      if (!cuts[j]) continue;
+      for (i = 0; i < cuts[j]->szcut; i++)
         queries_co[cuts[j]->cut[i]] = 1;
-      for (i = 1; i <= cuts[j]->szevscut; i++)
+      for (i = 0; i < cuts[j]->szevscut; i++)
         queries_ev[cuts[j]->evscut[i]] = 1;
     }
   }
 
-  for (i = 1; i <= numev; i++){
-    read_int(ev2tr[i]);
-    read_int(dummy);
-    if (!evcofile && m_repeat > 0 && cuts[m_repeat] && cuts[m_repeat]->repeat > 0) 
-      queries_ev[i] = dummy;
-  }
+  if (!evcofile && qcut && qcut->repeat > 0)
+    for (i = 1; i <= numev; i++)
+      queries_ev[i] = mci->ev_queried[i];
 
   for (i = 1; i <= numco; i++)
   {
-    read_int(co2pl[i]);
-    read_int(tokens[i]);
-    read_int(dummy);
-    if (!evcofile && m_repeat > 0 && cuts[m_repeat] && cuts[m_repeat]->repeat > 0) 
-      queries_co[i] = dummy;
-    read_int(pre_ev);
+    if (!evcofile && qcut && qcut->repeat > 0) 
+      queries_co[i] = mci->co_queried[i];
+    pre_ev = mci->co_pre[i];
     if (cutout && pre_ev && !evname && (queries_ev[pre_ev] || queries_co[i]) && !conf)
     {
       printf("  e%d -> c%d;\n",pre_ev,i);
@@ -174,112 +101,58 @@ int read_mci_file (char *mcifile, char *evcofile, int m_repeat, char* evname, in
     }
     else if (cutout && !pre_ev && !evname && queries_co[i] && !conf)
       queries_coset[i] = 1;
-    else if (!cutout && pre_ev && !evname) 
+    else if (!cutout && pre_ev && !evname && !conf) 
+      printf("  e%d -> c%d;\n",pre_ev,i);
+    if (!pre_ev) cut0[i] = 1;
+    for (k = mci->co_postidx[i]; k < mci->co_postidx[i+1]; k++)
     {
-      if (!conf) printf("  e%d -> c%d;\n",pre_ev,i);
-      if(tokens[i] && conf) clist_add(&evprps[pre_ev]->postset, i);
-    }
-    if (!pre_ev)
-    { 
-      if(tokens[i] && conf) clist_add(&evprps[0]->postset, i);
-      cut0[i] = 1;
-    }
-    do {
-      read_int(post_ev);
-      if (cutout && post_ev && !evname && (queries_ev[post_ev] || queries_co[i]) && !conf)
+      post_ev = mci->co_post[k];
+      if (cutout && !evname && (queries_ev[post_ev] || queries_co[i]) && !conf)
       {
         if (queries_ev[post_ev]) printf("  c%d -> e%d;\n",i,post_ev);
         queries_coset[i] = 1;
       }
-      else if (!cutout && post_ev && !evname)
-      { 
-        if (!conf) printf("  c%d -> e%d;\n",i,post_ev);
-        if(tokens[i] && conf) clist_add(&evprps[post_ev]->preset, i);
-      }
-    } while (post_ev);
+      else if (!cutout && !evname && !conf)
+        printf("  c%d -> e%d;\n",i,post_ev);
+    }
   }
 
-  for (;;) {
-    read_int(harmful);
-    if (!harmful) break;
-    harmfuls[harmful] = harmful;
-  }
+  for (i = 0; i < mci->numharmful; i++)
+    harmfuls[mci->harmful[i]] = mci->harmful[i];
 
-  for (;;) {
-    read_int(cutoff);
-    if (!cutoff) break;
-    cutoffs[cutoff] = cutoff;
-#ifdef CUTOFF
-    printf("  e%d [style=filled];\n",cutoff);
-#endif
-    read_int(dummy);
+  for (i = 0; i < mci->numcutoffs; i++)
+  {
+    cutoffs[mci->cutoffs[2*i]] = mci->cutoffs[2*i];
 #ifdef CUTOFF
-    printf("  e%d [style=dashed];\n",dummy);
+    printf("  e%d [style=filled];\n",mci->cutoffs[2*i]);
+    printf("  e%d [style=dashed];\n",mci->cutoffs[2*i+1]);
 #endif
   }
 
-  do { read_int(dummy); } while(dummy);
-  read_int(numpl);
-  read_int(numtr);
-  read_int(sz);
-
-  plname = malloc((numpl+2) * sizeof(char*));
-  trname = malloc((numtr+2) * sizeof(char*));
-
-  for (i = 1; i <= numpl+1; i++) plname[i] = malloc(sz+1);
-  for (i = 1; i <= numtr+1; i++) trname[i] = malloc(sz+1);
-
-  for (i=1; i <= numpl; i++)
-  {
-    read_int(idpl);
-    c = plname[idpl];
-    do { fread(c,1,1,mcif); } while (*c++);
-  }
-  fread(c,1,1,mcif);
-
-  for (i=1; i <= numtr; i++)
-  {
-    read_int(idtr);
-    c = trname[idtr];
-    do { fread(c,1,1,mcif); } while (*c++);
-  }
-  fread(c,1,1,mcif);
-
   int *cut = calloc(numco+1, sizeof(int));
   int *frsq = calloc(numev+1, sizeof(int));
 
   if(conf)
   {  
-    clist_t *list;
     char* sub;
     int coid;
     int subint;
     char* conf_copy = strdup(conf);
     char *markingstr = calloc(numpl*sz, sizeof(char));
     /* Add initial cut */
-    for(list = evprps[0]->postset; list; list = list->next)
-    {
-      coid = list->idcond;
-      cut[coid] = coid;
-    }
+    for (coid = 1; coid <= numco; coid++)
+      if (!mci->co_pre[coid] && tokens[coid]) cut[coid] = coid;
 
     sub = strtok(conf_copy, ",");
     while (sub != NULL)
     {
       subint = strtoint(sub);
       frsq[subint] = subint;
-      /* Remove event's preset */
-      for(list = evprps[subint]->preset; list; list = list->next)
-      {
-        coid = list->idcond;
-        cut[coid] = 0;
-      }
-      /* Add event's poset */
-      for(list = evprps[subint]->postset; list; list = list->next)
-      {
-        coid = list->idcond;
-        cut[coid] = coid;
-      }
+      /* Remove event's preset, add its postset */
+      for (k = mci->ev_preidx[subint]; k < mci->ev_preidx[subint+1] && !evname; k++)
+        if (tokens[coid = mci->ev_pre[k]]) cut[coid] = 0;
+      for (k = mci->ev_postidx[subint]; k < mci->ev_postidx[subint+1] && !evname; k++)
+        if (tokens[coid = mci->ev_post[k]]) cut[coid] = coid;
       sub = strtok(NULL, ",");
     }
 
@@ -349,8 +222,8 @@ int read_mci_file (char *mcifile, char *evcofile, int m_repeat, char* evname, in
         found = 1;
   }
 
-  fclose(mcif);
   if (evcofile) fclose(evcof);
+  mci_free(mci);
   return found;
 }
 
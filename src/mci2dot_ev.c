@@ -2,89 +2,196 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "mciread.h"
+
 #define LINE_SIZE 100
 
 
-typedef struct cut_t
+int strtoint(char *num) {
+  int  i, len;
+  int result = 0;
+
+  len = strlen(num);
+
+  for(i=0; i<len; i++)
+    result = result * 10 + ( num[i] - '0' );
+  return result;
+}
+
+/**
+ * @brief a growable list of events, used as one row of a relation
+ * between events (predecessors, successors, conflicts).
+ */
+typedef struct evlist_t
 {
-  int repeat;
-  int szcut, szevscut;
-  int *cut;
-  int *evscut;
-} cut_t;
+  int size, alloc;
+  int *ev;
+} evlist_t;
 
-typedef struct clist_t
+void evlist_add(evlist_t *list, int ev)
 {
-  int   idcond;
-  struct clist_t* next;
-} clist_t;
+  if (list->size == list->alloc)
+  {
+    list->alloc = list->alloc ? 2 * list->alloc : 4;
+    list->ev = realloc(list->ev, list->alloc * sizeof(int));
+    if (!list->ev)
+    {
+      fprintf(stderr, "Memory allocation failed.\n");
+      exit(1);
+    }
+  }
+  list->ev[list->size++] = ev;
+}
 
-typedef struct evprepost
+int evlist_has(evlist_t *list, int ev)
 {
-  clist_t *preset;
-  clist_t *postset;
-  struct evprepost *next;
-} evprepost;
+  int i;
+  for (i = 0; i < list->size; i++)
+    if (list->ev[i] == ev) return 1;
+  return 0;
+}
 
-clist_t* clist_add(clist_t** list, int idpl)
+int evlist_cmp(const void *a, const void *b)
 {
-  clist_t* newco = malloc(sizeof(clist_t));
-  newco->idcond = idpl;
-  newco->next = *list;
-  return *list = newco;
+  return *(const int*)a - *(const int*)b;
 }
 
-int strtoint(char *num) {
-  int  i, len;
-  int result = 0;
+/**
+ * @brief sort the rows of a relation and remove duplicates, so that
+ * iterating over a row visits the events in increasing order.
+ */
+void evlist_sort(evlist_t *rows, int numrows)
+{
+  int i, j, k;
+  for (i = 0; i < numrows; i++)
+  {
+    qsort(rows[i].ev, rows[i].size, sizeof(int), evlist_cmp);
+    for (j = k = 0; j < rows[i].size; j++)
+      if (!k || rows[i].ev[k-1] != rows[i].ev[j])
+        rows[i].ev[k++] = rows[i].ev[j];
+    rows[i].size = k;
+  }
+}
 
-  len = strlen(num);
+void evlist_free(evlist_t *rows, int numrows)
+{
+  int i;
+  for (i = 0; i < numrows; i++) free(rows[i].ev);
+  free(rows);
+}
 
-  for(i=0; i<len; i++)
-    result = result * 10 + ( num[i] - '0' );
-  return result;
+/**
+ * @brief remove the redundant immediate predecessors of an event, i.e.,
+ * those which are also predecessors of another immediate predecessor.
+ * Events are numbered in causal order, so the search only needs to go
+ * down to the lowest immediate predecessor.
+ *
+ * @param ev_predc immediate predecessors of every event (sorted).
+ * @param ev the event whose predecessors are reduced.
+ * @param seen, redundant work arrays stamped with ev.
+ * @param stack work array of numev+1 entries.
+ */
+void reduce_predecessors(evlist_t *ev_predc, int ev, int *seen, int *redundant, int *stack)
+{
+  evlist_t *pred = &ev_predc[ev];
+  int i, j, x, p, sp = 0, minpred;
+
+  if (pred->size < 2) return;
+  minpred = pred->ev[0];
+  for (i = 0; i < pred->size; i++)
+    for (j = 0; j < ev_predc[pred->ev[i]].size; j++)
+      if ((p = ev_predc[pred->ev[i]].ev[j]) >= minpred && seen[p] != ev)
+      {
+        seen[p] = ev;
+        stack[sp++] = p;
+      }
+  while (sp)
+  {
+    x = stack[--sp];
+    redundant[x] = ev;
+    for (j = 0; j < ev_predc[x].size; j++)
+      if ((p = ev_predc[x].ev[j]) >= minpred && seen[p] != ev)
+      {
+        seen[p] = ev;
+        stack[sp++] = p;
+      }
+  }
 }
 
 /**
- * @brief auxiliary function to find event successors of a particular event.
- * 
- * @param rows is the number of rows that the *matrix has.
- * @param cols is the number of cols that the *matrix has.
- * @param matrix matrix variable to look in for the event.
- * @param pre_ev the event source whose successor (post_ev) is needed.
- * @param post_ev the event target which it is a successor of (pre_ev).
- * @return integer we the event's index number if found else 0.
+ * @brief work arrays of the search for immediate conflicts, the event
+ * and condition arrays are stamped with the event whose past they mark.
  */
+typedef struct past_t
+{
+  int *evmark;    /* events in the past of the current event */
+  int *comark;    /* conditions consumed in that past ... */
+  int *coby;      /* ... and the event consuming them */
+  int *visit, pair, *stack;
+} past_t;
 
-int find_successor(int rows, int cols, int (*ev_succs)[cols], int pre_ev, int post_ev ){
-  size_t j, found = 0;
-  if(ev_succs[pre_ev][post_ev] != post_ev){ // if post_ev is not in the 
-                                          //immediate successors of pre_ev.
-    // we do loops to search in breadth.
-    for ( j = pre_ev+1; j < cols && found == 0; j++){
-      if( ev_succs[pre_ev][j] > 0)
-        found = find_successor(rows, cols, ev_succs, ev_succs[pre_ev][j], post_ev);
-      //if (found > 0) ev_succs[pre_ev][post_ev] = found;    
-    }
+/**
+ * @brief mark the causal past of an event (the event and its
+ * predecessors) and the conditions consumed in it.
+ */
+void mark_past(mci_t *mci, evlist_t *ev_predc, past_t *past, int ev)
+{
+  int sp = 0, x, i, co;
+
+  past->evmark[ev] = ev;
+  past->stack[sp++] = ev;
+  while (sp)
+  {
+    x = past->stack[--sp];
+    for (i = mci->ev_preidx[x]; i < mci->ev_preidx[x+1]; i++)
+      if (mci->co_token[co = mci->ev_pre[i]])
+      {
+        past->comark[co] = ev;
+        past->coby[co] = x;
+      }
+    for (i = 0; i < ev_predc[x].size; i++)
+      if (past->evmark[ev_predc[x].ev[i]] != ev)
+      {
+        past->evmark[ev_predc[x].ev[i]] = ev;
+        past->stack[sp++] = ev_predc[x].ev[i];
+      }
   }
-  else
-    found = post_ev;
-  return found;
 }
 
-int find_predecessor(int rows, int cols, int (*ev_predc)[cols], int pre_ev, int post_ev ){
-  size_t j, found = 0;
-  if(ev_predc[post_ev][pre_ev] != pre_ev){ // if pre_ev is not in the 
-                                          //immediate predecessors of post_ev.
-    // we do loops to search in breadth.
-    for ( j = 1; j < post_ev && found == 0; j++){
-      if( ev_predc[post_ev][j] > 0)
-        found = find_predecessor(rows, cols, ev_predc, pre_ev, ev_predc[post_ev][j]);
-    }
+/**
+ * @brief check whether the direct conflict between ev_a and ev_b is
+ * inherited from another direct conflict between events of their causal
+ * pasts. The past of ev_a must be marked by mark_past. Such a conflict
+ * is between an event of the past of ev_a and one of the past of ev_b
+ * which is not in the past of ev_a, so only the latter ones are visited,
+ * looking for a condition which is also consumed in the past of ev_a.
+ *
+ * @param queries_ev if not NULL, only conflicts between queried events count.
+ * @return 1 if the conflict is inherited, 0 if it is immediate.
+ */
+int conflict_inherited(mci_t *mci, evlist_t *ev_predc, past_t *past, int *queries_ev, int ev_a, int ev_b)
+{
+  int sp = 0, x, i, co, by;
+
+  past->pair++;
+  past->visit[ev_b] = past->pair;
+  past->stack[sp++] = ev_b;
+  while (sp)
+  {
+    x = past->stack[--sp];
+    for (i = mci->ev_preidx[x]; i < mci->ev_preidx[x+1]; i++)
+      if (mci->co_token[co = mci->ev_pre[i]] && past->comark[co] == ev_a
+          && ((by = past->coby[co]) != ev_a || x != ev_b)
+          && (!queries_ev || (queries_ev[by] && queries_ev[x])))
+        return 1;
+    for (i = 0; i < ev_predc[x].size; i++)
+      if (past->evmark[ev_predc[x].ev[i]] != ev_a && past->visit[ev_predc[x].ev[i]] != past->pair)
+      {
+        past->visit[ev_predc[x].ev[i]] = past->pair;
+        past->stack[sp++] = ev_predc[x].ev[i];
+      }
   }
-  else
-    found = pre_ev;
-  return found;
+  return 0;
 }
 
 char* ftokstr(char *str, int ins, char delim)
@@ -109,109 +216,54 @@ char* ftokstr(char *str, int ins, char delim)
   return i == len && ins >= c_delim ? NULL : tok;
 }
 
-int compute_cone_height(int numev, int (*ev_predc)[numev], int srcev, int height)
+int compute_cone_height(evlist_t *ev_predc, int srcev, int height)
 {
-  int i;
-  for (i = 1; i <= numev && !ev_predc[srcev][i]; i++) {}
-  if (ev_predc[srcev][i])
-    height = compute_cone_height(numev, ev_predc, ev_predc[srcev][i], ++height);
+  if (ev_predc[srcev].size)
+    height = compute_cone_height(ev_predc, ev_predc[srcev].ev[0], ++height);
   return height;
 }
 
-void check_cone(int numev, int (*ev_predc)[numev], char cone_ev[], int confl_evs[numev], int srcev)
+void check_cone(evlist_t *ev_predc, char cone_ev[], int srcev)
 {
   char str[10];
   sprintf(str, "%d,", srcev);
   strcat(cone_ev, str);
-  for (int i = 1; i <= numev; i++)
-    if (ev_predc[srcev][i])
-      check_cone(numev, ev_predc, cone_ev, confl_evs, ev_predc[srcev][i]);
+  for (int i = 0; i < ev_predc[srcev].size; i++)
+    check_cone(ev_predc, cone_ev, ev_predc[srcev].ev[i]);
 }
 
-void print_pathway(int numev, int (*ev_predc)[numev], int (*path_evs)[numev], char cone_ev[], char cone_ev2[], int minlen, int confl_evs[numev], int pre_ev, int link_ev)
+void print_pathway(evlist_t *ev_predc, evlist_t *path_evs, char cone_ev[], char cone_ev2[], int minlen, int confl_evs[], int pre_ev, int link_ev)
 {
-  /* if (pre_ev == 56){
-    printf("pre_ev: %d\n", pre_ev);
-    // printf("ev_predc[pre_ev][k]: %d\n", ev_predc[pre_ev][k]);
-    // printf("confl_evs[k]: %d\n", confl_evs[k]);
-  } */
-  for (int j = 1; j <= numev; j++)
-    if (ev_predc[pre_ev][j] && confl_evs[j] && !path_evs[j][link_ev])
+  evlist_t *pred = &ev_predc[pre_ev];
+  for (int m = 0; m < pred->size; m++)
+  {
+    int j = pred->ev[m];
+    if (confl_evs[j] && !evlist_has(&path_evs[j], link_ev))
     {
       printf("  e%d -> e%d [minlen=%d];\n", j, link_ev, pre_ev == link_ev ? 1 : minlen); // write the connection.
-      path_evs[j][0] = j;
-      path_evs[j][link_ev] = link_ev;
-      print_pathway(numev, ev_predc, path_evs, cone_ev, cone_ev2, 1, confl_evs, ev_predc[pre_ev][j], ev_predc[pre_ev][j]);
+      evlist_add(&path_evs[j], link_ev);
+      print_pathway(ev_predc, path_evs, cone_ev, cone_ev2, 1, confl_evs, j, j);
     }
-    else if (ev_predc[pre_ev][j] && !confl_evs[j] && !path_evs[j][link_ev])
+    else if (!confl_evs[j] && !evlist_has(&path_evs[j], link_ev))
     {
       cone_ev[0] = '\0';
       cone_ev2[0] = '\0';
-      int k = j+1;
-      while (k <= numev && k)
-      {
-        if (ev_predc[pre_ev][k] && confl_evs[k])
+      int found = 0;
+      for (int n = m+1; n < pred->size && !found; n++)
+        if (confl_evs[pred->ev[n]])
         {
-          check_cone(numev, ev_predc, cone_ev, confl_evs, j);
-          check_cone(numev, ev_predc, cone_ev2, confl_evs, k);
-          int m = 0;
-          char *tmp = ftokstr(cone_ev, m, ',');
+          check_cone(ev_predc, cone_ev, j);
+          check_cone(ev_predc, cone_ev2, pred->ev[n]);
+          int k = 0;
+          char *tmp = ftokstr(cone_ev, k, ',');
           while(tmp && !strstr(cone_ev2, tmp))
-            tmp = ftokstr(cone_ev, ++m, ',');
-          if(tmp) k = -1;
+            tmp = ftokstr(cone_ev, ++k, ',');
+          if(tmp) found = 1;
         }
-        else if (ev_predc[pre_ev][k] && !confl_evs[k])
-        {
-        }
-        k++;
-      }
-      if (k)
-        print_pathway(numev, ev_predc, path_evs, cone_ev, cone_ev2, ++minlen, confl_evs, ev_predc[pre_ev][j], link_ev);
-    }
-}
-
-int find_conflict(int rows, int cols, int (*ev_confl)[cols],
-  int (*ev_confl_copy)[cols], int(*ev_succs)[cols], int ev_cfl, int ev_src ){
-  size_t k;
-  int found = 0;
-  for (k = ev_cfl+1; k < cols && found == 0; k++){
-    if(ev_confl[ev_cfl][k] != 0){
-      found = find_successor(rows, cols, ev_succs, ev_src, ev_confl[ev_cfl][k]);
-      if(found > 0){
-        ev_confl_copy[ev_cfl][k] = 0;
-      }
-      else 
-        ev_confl_copy[ev_cfl][k] = find_conflict(rows, cols, ev_confl, ev_confl_copy, ev_succs, 
-            ev_confl[ev_cfl][k], ev_src) > 0 ? 0 : k;
-      //if (k > ev_src) ev_succs[ev_src][k] = ev_succs[ev_src][k] == 0 ? k : 0;
+      if (!found)
+        print_pathway(ev_predc, path_evs, cone_ev, cone_ev2, ++minlen, confl_evs, j, link_ev);
     }
   }
-  return found;
-}
-
-void display_matrix(int rows, int cols, int (*matrix)[cols]){
-  int i, j;
-  for (i=0; i<rows; i++)
-  {
-      for(j=0; j<cols; j++)
-      {
-        // upper triangular matrix
-        /* if(j >= i){
-          printf("%d   ", matrix[i][j]);
-        }else{
-          printf("    ");
-        } */
-
-        // lower triangular matrix
-        // if(i >= j) printf("%d   ", matrix[i][j]);
-        //printf("%*c", j, ' ');
-        // complete matrix
-        int tmp = matrix[i][j];
-        if (tmp <= 9) printf("%d   ", tmp);
-        else printf("%d  ", tmp);
-      }
-      printf("\n");
-  }
 }
 
 /**
@@ -221,34 +273,20 @@ void display_matrix(int rows, int cols, int (*matrix)[cols]){
  */
 void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout, char* conf, int pathway, int csv)
 {
-  #define read_int(x) fread(&(x),sizeof(int),1,mcif)
-  /* define a micro substitution to read_int.
-    &(x) - is the pointer to a block of memory with a minimum
-            size of "sizeof(int)*1" bytes.
-    sizeof(int) - is the size in bytes of each element to be read.
-    1 - is the number of elements, each one with a size of 
-        "sizeof(int)" bytes.
-    file - is the pointer to a FILE object that specifies an input stream.
-  */
-
-  FILE *mcif, *evevf, *file_nodes, *file_ends;
-  int nqure, nqure_, nquszcut, nquszevscut, szcuts, qnumcutoff = 0, qnumconfl = 0,
-    numco, numev, numpl, numtr, idpl, idtr, sz, i, j, value, ev1, ev2;
-  int pre_ev, post_ev, cutoff, harmful, dummy = 0, tmp = 0, count_mrk = 1, seq_size = 0;
-  int *co2pl, *ev2tr, *tokens, *queries_co,
+  FILE *evevf, *file_nodes, *file_ends;
+  mci_t *mci;
+  int szcuts, qnumcutoff = 0, qnumconfl = 0,
+    numco, numev, i, j, k, value, ev2;
+  int pre_ev, post_ev, dummy = 0, tmp = 0, count_mrk = 1, seq_size = 0;
+  int *seen, *redundant, *stack;
+  int *ev2tr, *tokens, *queries_co,
     *queries_ev, *cutoffs, *harmfuls, *confl_evs, *leaves_evs;
-  char **plname, **trname, *c;
+  char **trname;
   char valuech[12] = "", valuechtmp[12] = "";
   char fullfilename[LINE_SIZE], *fname;
-  cut_t **cuts;
-  evprepost **evprps;
-
+  mci_cut_t **cuts, *qcut;
 
-  if (!(mcif = fopen(mcifile,"rb")))
-  {
-    fprintf(stderr,"cannot read file %s\n",mcifile);
-    exit(1);
-  }
+  mci = mci_read(mcifile,0);
 
   if (evevfile)
   {
@@ -284,19 +322,16 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
   printf("digraph test {\n"); // start to creating the output 
                               //  file in dot format.
 
-  read_int(numco); // read from input file the total number of conditions.
-  read_int(numev); // read from input file the total number of events.
-
-  co2pl = malloc((numco+1) * sizeof(int)); // reserve empty memory for the total number 
-                                           // conditions.
-  tokens = malloc((numco+1) * sizeof(int)); // reserve the same amount of empty memory
-                                            // to save the particular tokens' conditions.
-  queries_co = malloc((numco+1) * sizeof(int)); // reserve the same amount of empty memory
-                                            // to save the particular queries' conditions.
-  queries_ev = malloc((numev+1) * sizeof(int)); // reserve the same amount of empty memory
-                                            // to save the particular queries' events.
-  ev2tr = malloc((numev+1) * sizeof(int)); // reserve empty memory for the total number 
-                                           // events.
+  numco = mci->numco; // the total number of conditions.
+  numev = mci->numev; // the total number of events.
+  tokens = mci->co_token; // whether conditions are empty or full with tokens
+                          // due to reset arcs.
+  ev2tr = mci->ev2tr; // transition of every event, eg., ev1 -> tr3 (ev2tr[1] -> 3)
+  trname = mci->trname;
+  cuts = mci->cuts;
+
+  queries_co = calloc(numco+1, sizeof(int)); // the particular queries' conditions.
+  queries_ev = calloc(numev+1, sizeof(int)); // the particular queries' events.
   //leaves_evs = calloc(numev+1, sizeof(int)); // collect events with no successors. 
   confl_evs = calloc(numev+1, sizeof(int)); // events that have at least one conflict.
 
@@ -304,49 +339,30 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
   harmfuls = calloc(numev+1, sizeof(int));
   leaves_evs = calloc(numev+1, sizeof(int)); // collect events with no successors
                                           // which are not cutoff events. Used when evev file is given.
-  evprps = calloc(numev+1, sizeof(evprepost*));
-  for (i = 0; i <= numev; i++) {
-    evprps[i] = malloc(sizeof(evprepost));
-    evprps[i]->preset = NULL;
-    evprps[i]->postset = NULL;
-  }
 
-  int (*co_postsets)[numev+1] = calloc(numco+1, sizeof *co_postsets);
-                                           // conditions' postsets to detect conflicts in events.
-  if (co_postsets == NULL) {
+  /* relations between events, one sorted row per event */
+  evlist_t *ev_predc = calloc(numev+1, sizeof(evlist_t)); // immediate predecessors.
+  evlist_t *ev_predc_copy = calloc(numev+1, sizeof(evlist_t)); // predecessors to print, i.e.,
+                                            // without the redundant ones.
+  evlist_t *ev_succs = calloc(numev+1, sizeof(evlist_t)); // immediate successors.
+  evlist_t *ev_confl_copy = calloc(numev+1, sizeof(evlist_t)); // immediate conflicts.
+  evlist_t *path_evs = calloc(numev+1, sizeof(evlist_t)); // events' pathway structure.
+  seen = calloc(numev+1, sizeof(int));
+  redundant = calloc(numev+1, sizeof(int));
+  stack = calloc(numev+1, sizeof(int));
+  if (!ev_predc || !ev_predc_copy || !ev_succs || !ev_confl_copy
+      || !path_evs || !seen || !redundant || !stack)
+  {
     fprintf(stderr, "Memory allocation failed.\n");
+    exit(1);
   }
-  int (*ev_predc_copy)[numev+1] = calloc(numev+1, sizeof *ev_predc_copy); // matrix to record events' predecesors.
-  int (*ev_predc)[numev+1] = calloc(numev+1, sizeof *ev_predc); // matrix to record events' predecesors.
-  int (*ev_succs)[numev+1] = calloc(numev+1, sizeof *ev_succs); // matrix to record events' successors.
-  int (*ev_confl)[numev+1] = calloc(numev+1, sizeof *ev_confl); // matrix to record events' conflicts.
-  int (*ev_confl_copy)[numev+1] = calloc(numev+1, sizeof *ev_confl_copy); // a copy of the previous variable.
-  int (*path_evs)[numev+1] = calloc(numev+1, sizeof *path_evs); // matrix to record events' pathway structure.
-
-  read_int(nqure);
-  nqure_ = abs(nqure);
-  cuts = calloc((szcuts = nqure_+1), sizeof(cut_t*));
-  if(nqure_ && !m_repeat)
-    dummy = nqure_;
-  else if(nqure_ && (m_repeat > szcuts-1 || m_repeat < 0))
+
+  szcuts = mci->numcuts+1;
+  if(szcuts > 1 && !m_repeat)
+    dummy = szcuts-1;
+  else if(szcuts > 1 && (m_repeat > szcuts-1 || m_repeat < 0))
     m_repeat = -1;
-  while(nqure_)
-  {
-    read_int(nquszcut);
-    read_int(nquszevscut);
-    cuts[nqure_] = malloc(sizeof(cut_t));
-    cuts[nqure_]->repeat = nqure;
-    cuts[nqure_]->szcut = nquszcut;
-    cuts[nqure_]->szevscut = nquszevscut;
-    cuts[nqure_]->cut = calloc(nquszcut+1, sizeof(int));
-    cuts[nqure_]->evscut = calloc(nquszevscut+1, sizeof(int));
-    for (i = 1; i <= nquszcut; i++)
-      read_int(cuts[nqure_]->cut[i]);
-    for (i = 1; i <= nquszevscut; i++)
-      read_int(cuts[nqure_]->evscut[i]);
-    read_int(nqure);
-    nqure_ = abs(nqure);
-  }
+  qcut = m_repeat > 0 && m_repeat < szcuts ? cuts[m_repeat] : NULL;
 
   if(evevfile)
   {
@@ -358,9 +374,9 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
         else
         {
           value = strtoint(valuech);
-          if (tmp && strcmp(valuechtmp, ""))
+          if (tmp && strcmp(valuechtmp, "") && value >= 0 && value <= numev)
           {
-            ev_predc_copy[value][tmp] = tmp;
+            evlist_add(&ev_predc_copy[value], tmp);
             strcpy(valuechtmp, "");
           }
           tmp = value;
@@ -376,9 +392,9 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
         else
         {
           value = strtoint(valuech);
-          if (tmp && strcmp(valuechtmp, ""))
+          if (tmp && strcmp(valuechtmp, "") && value >= 0 && value <= numev)
           {
-            ev_predc_copy[value][tmp] = tmp;
+            evlist_add(&ev_predc_copy[value], tmp);
             strcpy(valuechtmp, "");
           }
           tmp = value;
@@ -397,9 +413,9 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
         else
         {
           value = strtoint(valuech);
-          if (tmp && strcmp(valuechtmp, ""))
+          if (tmp && strcmp(valuechtmp, "") && value >= 0 && value <= numev)
           {
-            ev_predc_copy[value][tmp] = tmp;
+            evlist_add(&ev_predc_copy[value], tmp);
             strcpy(valuechtmp, "");
           }
           tmp = value;
@@ -411,243 +427,138 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
       }
     }
   }
-  else if (m_repeat > 0 && cuts[m_repeat] && cuts[m_repeat]->repeat < 0)
+  else if (qcut && qcut->repeat < 0)
   {
-    for (i = 1; i <= cuts[m_repeat]->szcut; i++)
-      queries_co[cuts[m_repeat]->cut[i]] = 1;
-    for (i = 1; i <= cuts[m_repeat]->szevscut; i++)
-      {queries_ev[cuts[m_repeat]->evscut[i]] = 1;
-      //printf("e%d, ", cuts[m_repeat]->evscut[i]);
-      }
-    //printf("\n");
+    for (i = 0; i < qcut->szcut; i++)
+      queries_co[qcut->cut[i]] = 1;
+    for (i = 0; i < qcut->szevscut; i++)
+      queries_ev[qcut->evscut[i]] = 1;
   }
   else if (!m_repeat)
   {
     for (j = 1; j <= dummy; j++)
     {
-      for (i = 1; i <= cuts[j]->szcut; i++)
+      if (!cuts[j]) continue;
+      for (i = 0; i < cuts[j]->szcut; i++)
         queries_co[cuts[j]->cut[i]] = 1;
-      for (i = 1; i <= cuts[j]->szevscut; i++)
+      for (i = 0; i < cuts[j]->szevscut; i++)
         queries_ev[cuts[j]->evscut[i]] = 1;
     }
   }
 
-  for (i = 1; i <= numev; i++){
-    read_int(ev2tr[i]); // assign a value to an entry in the array ev2tr for every event
-                        // in the unfolding in order to map its respective 
-                        // transition, eg., ev1 -> tr3 (ev2tr[1] -> 3)
-    read_int(dummy);
-    if (!evevfile && m_repeat > 0 && cuts[m_repeat] && cuts[m_repeat]->repeat > 0) 
-      queries_ev[i] = dummy; // assign a value to an entry in the array queries_ev for every event
-                        // in the unfolding in order to map its respective
-                        // query number, eg., ev1 -> 1 (queries_ev[1] -> 1)
-  }
+  if (!evevfile && qcut && qcut->repeat > 0)
+    for (i = 1; i <= numev; i++)
+      queries_ev[i] = mci->ev_queried[i]; // the query number of every event
+                        // in the unfolding, eg., ev1 -> 1 (queries_ev[1] -> 1)
 
   for (i = 1; i <= numco; i++)
   {
-    read_int(co2pl[i]); // assign a value to the ith entry co2pl array for
-                        // every condition in the unfolding in order to
-                        // map its respective place, eg., c2 -> pl4 
-                        // (co2pl[2] -> 4)
-    read_int(tokens[i]); // assign a value to the ith entry tokens array
-    read_int(queries_co[i]); // assign a value if the condition is queried but this feature is not displayable.
-                         // for every condition in the unfolding in order to
-                         // keep track of the conditions that are empty or full
-                         // with tokens due to reset arcs.
-    read_int(pre_ev); // read the respective event number (mark attribute
-                      // in event_t structure definition), if any, which is the only
-                      // event in the preset of a condition in the unfolding.
-    if (pre_ev && conf && tokens[i] && !cutout)
-      clist_add(&evprps[pre_ev]->postset, i);
-    else if (!pre_ev && conf && tokens[i] && !cutout)
-      clist_add(&evprps[0]->postset, i);
-    do {
-      read_int(post_ev);  // read the respective event number (mark attribute
-                          // in event_t structure definition), if any, which 
-                          // are the events in the postset of a condition in
-                          // the unfolding.
-      /* if (pathway && pre_ev && !post_ev && dummy != pre_ev) 
-      {
-        leaves_evs[pre_ev] = 1; 
-        dummy = pre_ev;
-      } */
-      if (!cutout && post_ev && tokens[i] && conf)
-        clist_add(&evprps[post_ev]->preset, i);
-      if(pre_ev && post_ev && ev_succs[pre_ev][post_ev] == 0 && tokens[i]){ 
-        ev_predc[post_ev][pre_ev] = pre_ev; // matrix of predeccesors to only print
-        ev_predc_copy[post_ev][pre_ev] = pre_ev; // matrix of predeccesors to only print
-                                            // immediate predecessors. Comment out if
-                                            // you want all dependencies. 
-        ev_succs[pre_ev][post_ev] = post_ev; 
-        /* Uncomment next 4 lines if you want to see all dependencies in events. */
-        // if (cutout && queries_ev[pre_ev] && queries_ev[post_ev])
-        //   printf("  e%d -> e%d;\n",pre_ev,post_ev); // write the connection.
-        // else if (!cutout)
-        //   printf("  e%d -> e%d;\n",pre_ev,post_ev); // write the connection.
-      }
-      // This else if is necessary to show dependencies to initial cut.
-      /* else if (!pre_ev && post_ev && ev_succs[0][post_ev] == 0)
-      {
-        ev_succs[0][post_ev] = post_ev;
-        if (!cutout)
-          printf("  e0 -> e%d;\n", post_ev);
-        else if (cutout && queries_ev[post_ev])
-          printf("  e0 -> e%d;\n", post_ev);
-      } */      
-      if (post_ev && tokens[i]) co_postsets[i][post_ev] = post_ev; 
-    } while (post_ev); // if post_ev is not null.
-  }
-  /* check immediate connections to events */
-  for (int i = 1; i <= numev; i++){
-    for (int j = 1; j <= i; j++){
-      for (int k = j+1; k <= i; k++)
-        if (ev_predc[i][j] > 0 && ev_predc[i][k] > 0)
-        {
-          if (ev_predc_copy[i][j] == 0) 
-            continue;
-          else
-            ev_predc_copy[i][j] = 
-            find_predecessor(numev+1, numev+1, ev_predc, 
-              ev_predc[i][j], ev_predc[i][k]) ? 0 : ev_predc[i][j]; 
-        }
+    queries_co[i] = mci->co_queried[i]; // the condition is queried but this
+                         // feature is not displayable.
+    pre_ev = mci->co_pre[i]; // the event in the preset of the condition, if any.
+    if (!pre_ev || !tokens[i]) continue;
+    for (k = mci->co_postidx[i]; k < mci->co_postidx[i+1]; k++)
+    {
+      post_ev = mci->co_post[k]; // the events in the postset of the condition.
+      evlist_add(&ev_predc[post_ev], pre_ev);
+      evlist_add(&ev_succs[pre_ev], post_ev);
     }
   }
+  evlist_sort(ev_predc, numev+1);
+  evlist_sort(ev_succs, numev+1);
+
+  /* check immediate connections to events: keep the predecessors which
+     are not predecessors of another one, along with the links read from
+     the evev file that are not immediate predecessors. */
+  for (i = 1; i <= numev; i++)
+  {
+    reduce_predecessors(ev_predc, i, seen, redundant, stack);
+    for (j = 0; j < ev_predc[i].size; j++)
+      seen[ev_predc[i].ev[j]] = -i;
+    for (j = k = 0; j < ev_predc_copy[i].size; j++)
+      if (seen[ev_predc_copy[i].ev[j]] != -i)
+        ev_predc_copy[i].ev[k++] = ev_predc_copy[i].ev[j];
+    ev_predc_copy[i].size = k;
+    for (j = 0; j < ev_predc[i].size; j++)
+      if (redundant[ev_predc[i].ev[j]] != i)
+        evlist_add(&ev_predc_copy[i], ev_predc[i].ev[j]);
+  }
+  evlist_sort(ev_predc_copy, numev+1);
 
   /* print immediate connections to events */
   if (!pathway)
   {
     for (int i = 1; i <= numev; i++){
-      for (int j = 1; j <= i; j++){
-        //if (i == 19) printf("%d,", ev_predc_copy[i][j]);
-        if (ev_predc_copy[i][j] > 0)
+      for (int k = 0; k < ev_predc_copy[i].size && ev_predc_copy[i].ev[k] <= i; k++){
+        int j = ev_predc_copy[i].ev[k];
+        if (cutout && queries_ev[i] && queries_ev[j])
         {
-          if (cutout && queries_ev[i] && queries_ev[j])
-          {
-            printf("  e%d -> e%d;\n",j,i); // write the connection.
-            if(csv) fprintf(file_ends,"\"edge\",\"e%d\",\"e%d\"\n",j, i);
-          }
-          else if (!cutout)
-          {
-            printf("  e%d -> e%d;\n",j,i); // write the connection.
-            if(csv) fprintf(file_ends,"\"edge\",\"e%d\",\"e%d\"\n",j, i);
-          }
+          printf("  e%d -> e%d;\n",j,i); // write the connection.
+          if(csv) fprintf(file_ends,"\"edge\",\"e%d\",\"e%d\"\n",j, i);
+        }
+        else if (!cutout)
+        {
+          printf("  e%d -> e%d;\n",j,i); // write the connection.
+          if(csv) fprintf(file_ends,"\"edge\",\"e%d\",\"e%d\"\n",j, i);
         }
       }
     }
   }
 
-  for (;;) {
-    read_int(harmful);
-    if (!harmful) break;
-    harmfuls[harmful] = harmful;
-  }
+  for (i = 0; i < mci->numharmful; i++)
+    harmfuls[mci->harmful[i]] = mci->harmful[i];
   
   if (!cutout || !m_repeat)
   {  
-    // A loop over co_postsets matrix to fill ev_confl matrix with conflicts
-    // among events part of the same condition's postset. We make a copy 
-    // conflicts to find immediate conflicts correctly in the function right after.
-    for (size_t i = 1; i <= numco; i++){
-      for (size_t j = 1; j <= numev-1; j++){
-        for (size_t k = j+1; k <= numev; k++){
-          ev1 = co_postsets[i][j]; ev2 = co_postsets[i][k];
-          if (cutout && queries_ev[j] && queries_ev[k] && 
-              ev1 != 0 && ev2 != 0 && ev_confl[ev1][ev2] == 0)
-          {
-            ev_confl[ev1][ev2] = ev2;
-            ev_confl_copy[ev1][ev2] = ev2;
-          }
-          else if (!cutout && ev1 != 0 && ev2 != 0 && ev_confl[ev1][ev2] == 0)
+    // Events in the postset of the same condition are in conflict. Such a
+    // direct conflict is not immediate if it is inherited from another direct
+    // conflict between events of their pasts, eg., e2 and e3 are in conflict
+    // and e4 is a successor of e2, then the conflict between e4 and e3 is
+    // inherited from e2 and e3. For every event, ev_confl collects the greater
+    // events in direct conflict with it and ev_confl_copy keeps the immediate
+    // conflicts among them, so only the latter are stored for all events.
+    past_t past = { calloc(numev+1, sizeof(int)), calloc(numco+1, sizeof(int)),
+                    calloc(numco+1, sizeof(int)), calloc(numev+1, sizeof(int)), 0,
+                    calloc(numev+1, sizeof(int)) };
+    int *partner = calloc(numev+1, sizeof(int));
+    evlist_t ev_confl = {0, 0, NULL};
+    for (i = 1; i <= numev; i++)
+    {
+      for (j = mci->ev_preidx[i]; j < mci->ev_preidx[i+1]; j++)
+      {
+        if (!tokens[k = mci->ev_pre[j]]) continue;
+        for (k = mci->co_postidx[k]; k < mci->co_postidx[mci->ev_pre[j]+1]; k++)
+        {
+          ev2 = mci->co_post[k];
+          if (ev2 > i && partner[ev2] != i && (!cutout || (queries_ev[i] && queries_ev[ev2])))
           {
-            ev_confl[ev1][ev2] = ev2;
-            ev_confl_copy[ev1][ev2] = ev2;
+            partner[ev2] = i;
+            evlist_add(&ev_confl, ev2);
           }
         }
       }
+      if (!ev_confl.size) continue;
+      qsort(ev_confl.ev, ev_confl.size, sizeof(int), evlist_cmp);
+      mark_past(mci, ev_predc, &past, i);
+      for (j = 0; j < ev_confl.size; j++)
+        if (!conflict_inherited(mci, ev_predc, &past, cutout ? queries_ev : NULL, i, ev_confl.ev[j]))
+          evlist_add(&ev_confl_copy[i], ev_confl.ev[j]);
+      ev_confl.size = 0;
     }
-    // A loop over ev_confl matrix to find two pairwise conflict between events, eg.,
-    // e2->e3 and e3->e4, thereafter with find_successor we use ev_confl_succs to check 
-    // if e4 is a successor of e2, if yes we remove the conflict between e4 and e3
-    // because the conflict is inherited from e2 and e3, so we leave only immediate
-    // conflicts. Finally, we use the matrix ev_confl_copy to remove those "redundant
-    // conflicts" while ev_confl remains unchangeable to keep the trace of conflicts
-    // for posterior relations.
-    //display_matrix(numev+1, numev+1, ev_confl_copy);
-    for (size_t i = 1; i <= numev; i++)
-      for (size_t j = i+1; j <= numev; j++)
-        if (cutout && queries_ev[i] && queries_ev[j] && ev_succs[i][j] == 0)
-          ev_succs[i][j] = find_successor(numev+1, numev+1, ev_succs, i, j);
-        else if(!cutout && ev_succs[i][j] == 0)
-          ev_succs[i][j] = find_successor(numev+1, numev+1, ev_succs, i, j);
-    
-    
-    for (size_t i = 1; i <= numev; i++){
-      for (size_t j = i+1; j <= numev; j++){
-        if(cutout && queries_ev[i] && queries_ev[j] && ev_confl[i][j] > 0)
-        {
-          for(size_t k = i+1; k <= numev; k++)
-            if(ev_succs[i][k] > 0){
-              if(k > j) ev_confl_copy[j][k] = 0;
-              else ev_confl_copy[k][j] = 0;
-            }
-              //{ev_confl_copy[j][k] = k > j ? ev_confl[j][k] > 0;}
-          for(size_t k = j+1; k <= numev; k++)
-            if(ev_succs[j][k] > 0){
-              if(k > i) ev_confl_copy[i][k] = 0;
-              else ev_confl_copy[k][i] = 0;
-            }
-
-          for (size_t k = i+1; k <= numev; k++)
-            for (size_t m = j+1; m <= numev; m++)
-              if(ev_succs[i][k] > 0 && ev_succs[j][m] > 0){
-                if(k > m) ev_confl_copy[m][k] = 0;
-                else ev_confl_copy[k][m] = 0;
-              }
-        }
-        else if(!cutout && ev_confl[i][j] > 0)
-        {
-          for(size_t k = i+1; k <= numev; k++)
-            if(ev_succs[i][k] > 0){
-              if(k > j) ev_confl_copy[j][k] = 0;
-              else ev_confl_copy[k][j] = 0;
-            }
-              //{ev_confl_copy[j][k] = k > j ? ev_confl[j][k] > 0;}
-          for(size_t k = j+1; k <= numev; k++)
-            if(ev_succs[j][k] > 0){
-              if(k > i) ev_confl_copy[i][k] = 0;
-              else ev_confl_copy[k][i] = 0;
-            }
-
-          for (size_t k = i+1; k <= numev; k++)
-            for (size_t m = j+1; m <= numev; m++)
-              if(ev_succs[i][k] > 0 && ev_succs[j][m] > 0){
-                if(k > m) ev_confl_copy[m][k] = 0;
-                else ev_confl_copy[k][m] = 0;
-              }
-        }
-      }
-    }
-  }
-  /* Printing event corresponding to the initial cut. We make use of 
-  the empty vector of index 0 in ev_succs matrix to collect all events 
-  that have predecesors and hence to depict the arcs in the resulting 
-  dot file */
-  for (int i = 1; i <= numev; i++){
-    for (int j = i+1; j <= numev; j++){
-      if (ev_succs[i][j] > 0 && ev_succs[0][j] == 0) 
-        ev_succs[0][j] = ev_succs[i][j];
-    }
+    free(past.evmark); free(past.comark); free(past.coby);
+    free(past.visit); free(past.stack); free(partner); free(ev_confl.ev);
   }
-  
+  /* Printing event corresponding to the initial cut, i.e., the events 
+  that have no predecessors. */
   if (!pathway)
   {
     for (int i = 1; i <= numev; i++){
-      if (!cutout && ev_succs[0][i] == 0) 
+      if (!cutout && !ev_predc[i].size) 
       {
         printf("  e0 -> e%d;\n", i);
         if(csv) fprintf(file_ends,"\"edge\",\"e0\",\"e%d\"\n", i);
       }
-      else if (cutout && ev_succs[0][i] == 0 && queries_ev[i])
+      else if (cutout && !ev_predc[i].size && queries_ev[i])
       {
         printf("  e0 -> e%d;\n", i);
         if(csv) fprintf(file_ends,"\"edge\",\"e0\",\"e%d\"\n", i);
@@ -658,42 +569,38 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
   if(!cutout || !m_repeat)
   {  
     printf("\n//conflicts\n");
-    //display_matrix(numev+1, numev+1, ev_succs);
-    //display_matrix(numev+1, numev+1, ev_confl_copy);
-    // After leaving only immediate conflicts we do a loop over ev_confl
+    // After leaving only immediate conflicts we do a loop over ev_confl_copy
     // to write in the output file those conflict relations.
     for (int i = 1; i <= numev; i++){
-      for (int j = i+1; j <= numev; j++)
+      for (int k = 0; k < ev_confl_copy[i].size; k++)
       {
-        if (cutout && queries_ev[i] && queries_ev[j] && ev_confl_copy[i][j])
+        int j = ev_confl_copy[i].ev[k];
+        if (cutout && queries_ev[i] && queries_ev[j])
         {
           confl_evs[i] = j;
           confl_evs[j] = i;
           qnumconfl += 2;
-          printf("  e%d -> e%d [arrowhead=none color=gray60 style=dashed constraint=false];\n",i,ev_confl_copy[i][j]);
-          if(csv) fprintf(file_ends,"\"conflict\",\"e%d\",\"e%d\"\n", i,ev_confl_copy[i][j]);
+          printf("  e%d -> e%d [arrowhead=none color=gray60 style=dashed constraint=false];\n",i,j);
+          if(csv) fprintf(file_ends,"\"conflict\",\"e%d\",\"e%d\"\n", i,j);
         }
-        else if (!cutout && ev_confl_copy[i][j])
+        else if (!cutout)
         {
-          printf("  e%d -> e%d [arrowhead=none color=gray60 style=dashed constraint=false];\n",i,ev_confl_copy[i][j]);
-          if(csv) fprintf(file_ends,"\"conflict\",\"e%d\",\"e%d\"\n", i,ev_confl_copy[i][j]);
+          printf("  e%d -> e%d [arrowhead=none color=gray60 style=dashed constraint=false];\n",i,j);
+          if(csv) fprintf(file_ends,"\"conflict\",\"e%d\",\"e%d\"\n", i,j);
         }
       }
     }
     printf("\n");
   }
 
-  for (;;) {
-    read_int(cutoff);
-    if (!cutoff) break;
-    cutoffs[cutoff] = cutoff;
-    if (queries_ev[cutoff]) qnumcutoff++;
-#ifdef CUTOFF
-    printf("  e%d [style=filled];\n",cutoff);
-#endif
-    read_int(dummy);
+  for (i = 0; i < mci->numcutoffs; i++)
+  {
+    j = mci->cutoffs[2*i];
+    cutoffs[j] = j;
+    if (queries_ev[j]) qnumcutoff++;
 #ifdef CUTOFF
-    printf("  e%d [style=dashed];\n",dummy);
+    printf("  e%d [style=filled];\n",j);
+    printf("  e%d [style=dashed];\n",mci->cutoffs[2*i+1]);
 #endif
   }
 
@@ -710,6 +617,14 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
     dummy = 0;
     tmp = 1;
     int k, dummy2 = 0;
+    /* events with a queried successor: an immediate one, or any one
+       if the conflicts were computed above */
+    int *qsuccs = calloc(numev+1, sizeof(int));
+    for (i = numev; i >= 1; i--)
+      for (j = 0; j < ev_succs[i].size; j++)
+        if (queries_ev[ev_succs[i].ev[j]]
+            || ((!cutout || !m_repeat) && qsuccs[ev_succs[i].ev[j]]))
+          qsuccs[i] = 1;
     for (i = 1; i <= numev; i++)
       if (queries_ev[i] && cutoffs[i])
       {
@@ -719,9 +634,8 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
       }
       else if(queries_ev[i] && !cutoffs[i])
       {
-        for (j = 1; j <= numev && tmp; j++)
-          if (ev_succs[i][j] && queries_ev[j])
-            tmp = 0;
+        if (qsuccs[i])
+          tmp = 0;
         if (tmp && !leaves_evs[i] && !path_seq[dummy])
         {
           path_seq[dummy] = i;
@@ -734,100 +648,60 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
     dummy = 0;
     for (i = 0; i < seq_size; i++)
       if (path_seq[i])
-        print_pathway(numev+1, ev_predc_copy, path_evs, cone_ev, cone_ev2, 1, confl_evs, path_seq[i], path_seq[i]);
+        print_pathway(ev_predc_copy, path_evs, cone_ev, cone_ev2, 1, confl_evs, path_seq[i], path_seq[i]);
     
     memset(path_seq, 0, sizeof(path_seq));
     for (i = 1; i <= numev; i++)
-      if (path_evs[i][0] && !dummy)
+      if (path_evs[i].size && !dummy)
       {
-        printf("  e0 -> e%d [minlen=%d];\n", path_evs[i][0], compute_cone_height(numev+1,ev_predc_copy,path_evs[i][0],1));
-        if(csv) fprintf(file_ends,"\"edge\",\"e0\",\"e%d\"\n", path_evs[i][0]);
-        path_seq[0] = path_evs[i][0];
+        printf("  e0 -> e%d [minlen=%d];\n", i, compute_cone_height(ev_predc_copy,i,1));
+        if(csv) fprintf(file_ends,"\"edge\",\"e0\",\"e%d\"\n", i);
+        path_seq[0] = i;
         dummy++;
       }
-      else if (path_evs[i][0] && dummy)
+      else if (path_evs[i].size && dummy)
       {
-        for (k = 0; k < seq_size; k++)
-        {
-          for (j = 1; j <= numev && !dummy2; j++)
-            if (path_seq[k] && path_evs[path_seq[k]][j] == path_evs[i][0])
-              dummy2 = 1;
-        }
+        for (k = 0; k < seq_size && !dummy2; k++)
+          if (path_seq[k] && evlist_has(&path_evs[path_seq[k]], i))
+            dummy2 = 1;
         if (!dummy2) 
         {
-          printf("  e0 -> e%d [minlen=%d];\n", path_evs[i][0], compute_cone_height(numev+1,ev_predc_copy,path_evs[i][0],1));
-          if(csv) fprintf(file_ends,"\"edge\",\"e0\",\"e%d\"\n", path_evs[i][0]);
+          printf("  e0 -> e%d [minlen=%d];\n", i, compute_cone_height(ev_predc_copy,i,1));
+          if(csv) fprintf(file_ends,"\"edge\",\"e0\",\"e%d\"\n", i);
         }
-        path_seq[dummy] = path_evs[i][0];
+        path_seq[dummy] = i;
         dummy++;
         dummy2 = 0;
       }
       else if (i == numev)
         printf("\n");
+    free(qsuccs);
   }
 
-  do { read_int(dummy); } while(dummy);
-  read_int(numpl);
-  read_int(numtr);
-  read_int(sz);
-
-  plname = malloc((numpl+2) * sizeof(char*));
-  trname = malloc((numtr+2) * sizeof(char*));
-
-  for (i = 1; i <= numpl+1; i++) plname[i] = malloc(sz+1);
-  for (i = 1; i <= numtr+1; i++) trname[i] = malloc(sz+1);
-
-  for (i=1; i <= numpl; i++)
-  {
-    read_int(idpl);
-    c = plname[idpl];
-    do { fread(c,1,1,mcif); } while (*c++);
-  }
-  fread(c,1,1,mcif);
-
-  for (i=1; i <= numtr; i++)
-  {
-    read_int(idtr);
-    c = trname[idtr];
-    do { fread(c,1,1,mcif); } while (*c++);
-  }
-  fread(c,1,1,mcif);
-
   int *cut = calloc(numco+1, sizeof(int));
   /* firing sequence */
   int *frsq = calloc(numev+1, sizeof(int));
 
   if(conf)
   {  
-    clist_t *list;
     char* sub;
     int coid;
     int subint;
     char* conf_copy = strdup(conf);
     /* Add initial cut */
-    for(list = evprps[0]->postset; list; list = list->next)
-    {
-      coid = list->idcond;
-      cut[coid] = coid;
-    }
+    for (coid = 1; coid <= numco; coid++)
+      if (!mci->co_pre[coid] && tokens[coid]) cut[coid] = coid;
 
     sub = strtok(conf_copy, ",");
     while (sub != NULL)
     {
       subint = strtoint(sub);
       frsq[subint] = subint;
-      /* Remove event's preset */
-      for(list = evprps[subint]->preset; list; list = list->next)
-      {
-        coid = list->idcond;
-        cut[coid] = 0;
-      }
-      /* Add event's poset */
-      for(list = evprps[subint]->postset; list; list = list->next)
-      {
-        coid = list->idcond;
-        cut[coid] = coid;
-      }
+      /* Remove event's preset, add its postset */
+      for (k = mci->ev_preidx[subint]; k < mci->ev_preidx[subint+1]; k++)
+        if (tokens[coid = mci->ev_pre[k]]) cut[coid] = 0;
+      for (k = mci->ev_postidx[subint]; k < mci->ev_postidx[subint+1]; k++)
+        if (tokens[coid = mci->ev_post[k]]) cut[coid] = coid;
       sub = strtok(NULL, ",");
     }
   }
@@ -896,8 +770,12 @@ void read_mci_file_ev (char *mcifile, char* evevfile, int m_repeat, int cutout,
   printf("  e0 [fillcolor=\"white\" label=\"⊥\" shape=box style=filled];\n");
   printf("}\n");
 
-  fclose(mcif);
   if (evevfile) fclose(evevf);
+  evlist_free(ev_predc, numev+1); evlist_free(ev_predc_copy, numev+1);
+  evlist_free(ev_succs, numev+1);
+  evlist_free(ev_confl_copy, numev+1); evlist_free(path_evs, numev+1);
+  free(seen); free(redundant); free(stack);
+  mci_free(mci);
 }
 
 void usage ()
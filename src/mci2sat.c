@@ -17,8 +17,8 @@
 #include <assert.h>
 
 #include "common.h"
-
-#define P(args...) fprintf (fout, ##args)
+#include "mciread.h"
+#include "cdcl.h"
 
 void error (const char * fmt, ...)
 {
@@ -28,27 +28,7 @@ void error (const char * fmt, ...)
   verrx (EXIT_FAILURE, fmt, args);
 }
 
-char *bpos;
-
-static unsigned int read_int ()
-{
-  int i = *(int*)bpos;
-  bpos += sizeof(int);
-  return i;
-}
-
-static void read_str ()
-{
-  while (*bpos++);
-}
-
-typedef struct cut_t
-{
-  int repeat;
-  int szcut, szevscut;
-  int *cut;
-  int *evscut;
-} cut_t;
+mci_t *mci;
 
 typedef struct list_t {
   int alloc;
@@ -115,6 +95,88 @@ void print_clist(clist_t *l)
 
 FILE *fout;
 
+/* The formula is written in two passes: the first one only counts the
+   variables and clauses, so that the header can be written first and the
+   output does not need to be seekable (it can be a pipe, "-o -" writes to
+   standard output); the second one writes the clauses into a large buffer
+   that is flushed whenever it is full. */
+
+#define OUTBUF_SIZE (1 << 20)
+
+char *outbuf;		// clauses not yet written to fout
+int outlen = 0;
+char counting = 0;	// first pass: count clauses, write nothing
+
+void out_flush ()
+{
+  if (outlen && fwrite(outbuf,1,outlen,fout) != outlen)
+    error("write error: %s", strerror (errno));
+  outlen = 0;
+}
+
+void P (const char *fmt, ...)
+{
+  va_list args;
+  int n;
+
+  if (counting) return;
+  for (;;)
+  {
+    va_start(args, fmt);
+    n = vsnprintf(outbuf + outlen, OUTBUF_SIZE - outlen, fmt, args);
+    va_end(args);
+    if (outlen + n < OUTBUF_SIZE) break;
+    if (!outlen) error("line too long in output");
+    out_flush();
+  }
+  outlen += n;
+}
+
+void out_int (int n)
+{
+  char digits[12];
+  unsigned int u = n < 0 ? -(unsigned int) n : n;
+  int k = 0;
+
+  if (outlen + 13 > OUTBUF_SIZE) out_flush();
+  if (n < 0) outbuf[outlen++] = '-';
+  do digits[k++] = '0' + u % 10; while ((u /= 10));
+  while (k) outbuf[outlen++] = digits[--k];
+  outbuf[outlen++] = ' ';
+}
+
+/* Names of the places carrying some condition of the prefix, as well as
+   these names up to their last '_', kept in an open-addressing table; a
+   target is only considered if it is one of them. */
+
+char **names;
+int names_size;
+
+unsigned int name_hash (const char *name)
+{
+  unsigned int h = 2166136261u;
+  while (*name) h = (h ^ (unsigned char) *name++) * 16777619u;
+  return h;
+}
+
+int names_slot (const char *name)
+{
+  int i = name_hash(name) & (names_size - 1);
+  while (names[i] && strcmp(names[i],name)) i = (i + 1) & (names_size - 1);
+  return i;
+}
+
+void names_add (char *name)
+{
+  int i = names_slot(name);
+  if (!names[i]) names[i] = name;
+}
+
+int names_has (const char *name)
+{
+  return names[names_slot(name)] != NULL;
+}
+
 int numpl, numtr, idpl, events, conds;
 char *cutoff;		// indicates which events are cutoffs (=1)
 int *evtrl;		// maps non-cutoff events to variable indices
@@ -133,6 +195,38 @@ clist_t *p_reach, *n_reach; // positive and negative reachability targets
 char opt_comments = 0;	// whether to put comments into the sat file
 char opt_reach = 0;	// perform reachability (=1) or deadlock (=0)
 char opt_final = 0;	// find a final configuration
+char *opt_targets = NULL;	// file of targets for a session (-t)
+
+cdcl_t *solver = NULL;	// in a session, clauses go to the built-in solver
+int solver_vars = 0;
+int *clause_buf, clause_size, clause_alloc;
+
+/* Clauses are written literal by literal and ended with cl_end; in a
+   session they are added to the solver instead of the .sat file. */
+
+void cl_lit (int lit)
+{
+  if (counting) return;
+  if (!solver) { out_int(lit); return; }
+  while (abs(lit) > solver_vars) solver_vars = cdcl_newvar(solver);
+  if (clause_size == clause_alloc)
+    clause_buf = realloc(clause_buf,(clause_alloc = 2*clause_alloc+16)*sizeof(int));
+  clause_buf[clause_size++] = lit;
+}
+
+void cl_end ()
+{
+  clauses++;
+  if (counting) return;
+  if (!solver)
+  {
+    if (outlen + 2 > OUTBUF_SIZE) out_flush();
+    outbuf[outlen++] = '0'; outbuf[outlen++] = '\n';
+    return;
+  }
+  cdcl_add(solver,clause_buf,clause_size);
+  clause_size = 0;
+}
 
 void causal (int c, int father, list_t *post)
 {
@@ -145,8 +239,7 @@ void causal (int c, int father, list_t *post)
   // \/ post -> father
   for (i = 0; i < post->size; i++)
   {
-    P("-%d %d 0\n",evtrl[iptr[i]],evtrl[father]);
-    clauses++;
+    cl_lit(-evtrl[iptr[i]]); cl_lit(evtrl[father]); cl_end();
   }
 }
 
@@ -159,24 +252,22 @@ void condition_marked (int c, int place, int gen, list_t *post)
   if (opt_reach && !plwanted[place]) return;
 
   cotrl[c] = ++vars;
-  if (opt_reach) l_add(plcond+place,c);	// collect conds with that label
 
   if (opt_comments) P("\nc condition c%d (%s) ~ var %d\n",c,
     plname[place],vars);
   if (opt_comments) P("c whether c%d is marked\n",c);
 
   // gen /\ !post -> cond
-  if (gen) P("-%d ",evtrl[gen]);
-  P("%d ",cotrl[c]);
-  for (i = 0; i < post->size; i++) P("%d ",evtrl[iptr[i]]);
-  P("0\n");
-  clauses++;
+  if (gen) cl_lit(-evtrl[gen]);
+  cl_lit(cotrl[c]);
+  for (i = 0; i < post->size; i++) cl_lit(evtrl[iptr[i]]);
+  cl_end();
 
   if (!opt_reach && !opt_final) return;
   // cond -> gen /\ !post
-  if (gen) { P("-%d %d 0\n",cotrl[c],evtrl[gen]); clauses++; }
+  if (gen) { cl_lit(-cotrl[c]); cl_lit(evtrl[gen]); cl_end(); }
   for (i = 0; i < post->size; i++)
-    { P("-%d -%d 0\n",cotrl[c],evtrl[iptr[i]]); clauses++; }
+    { cl_lit(-cotrl[c]); cl_lit(-evtrl[iptr[i]]); cl_end(); }
 }
 
 int intlog (int n)
@@ -209,11 +300,11 @@ int confl_recur (list_t *post, int lower, int upper, int propag)
     v1 = confl_recur(post,lower,middle-1,1);
     v2 = confl_recur(post,middle,upper,1);
   }
-  P("-%d -%d 0\n",v1,v2); clauses++;
+  cl_lit(-v1); cl_lit(-v2); cl_end();
   if (!propag) return 0;
   vars++;
-  P("-%d %d 0\n",v1,vars); clauses++;
-  P("-%d %d 0\n",v2,vars); clauses++;
+  cl_lit(-v1); cl_lit(vars); cl_end();
+  cl_lit(-v2); cl_lit(vars); cl_end();
   return vars;
 }
 
@@ -228,9 +319,8 @@ void disabled (int e, list_t *pre)
 {
   int i, *iptr = &(pre->contents);
   if (opt_comments) P("\nc event e%d disabled\n",e);
-  for (i = 0; i < pre->size; i++) P("-%d ",cotrl[iptr[i]]);
-  P("0\n");
-  clauses++;
+  for (i = 0; i < pre->size; i++) cl_lit(-cotrl[iptr[i]]);
+  cl_end();
 }
 
 void reachable ()
@@ -249,9 +339,8 @@ void reachable ()
       if (opt_comments)
         P("\nc place %s is marked\n",plname[i]);
       for (j = 0; j < conds->size; j++)
-        P("%d ",cotrl[jptr[j]]);
-      P("0\n");
-      clauses++;
+        cl_lit(cotrl[jptr[j]]);
+      cl_end();
     }
     else
     {
@@ -259,115 +348,184 @@ void reachable ()
         P("\nc place %s is unmarked\n",plname[i]);
       for (j = 0; j < conds->size; j++)
       {
-        P("-%d 0\n",cotrl[jptr[j]]);
-        clauses++;
+        cl_lit(-cotrl[jptr[j]]);
+        cl_end();
       }
     }
   }
 }
 
-int mci2sat (const char * infile, const char *outfile)
+/* Session (-t): every place gets a variable that is true iff one of its
+   conditions is marked, on top of the constraints of the configurations,
+   which are encoded once. Each line of the targets file is then checked
+   by solving under assumptions on these variables, so the clauses learnt
+   for one target help with the next. Names are matched like with -r and
+   -n; a name preceded by '!' is a negative target. The results go to
+   outfile (standard output if empty): "reachable <targets>" followed by
+   the configuration and its cut in the layout of .evco files, or
+   "unreachable <targets>". The output is flushed after every target, so
+   that a program feeding the targets through a pipe gets each answer
+   as it comes. */
+
+int session (const char *outfile)
 {
-  int i, j, e, maxszname = 1;
-  list_t *post;
-  char *blob, *bconds, *plinunf;
-  int *harmfuls;
-  int nqure, nqure_, nquszcut, nquszevscut, szcuts, harmful, token, queried;
-  cut_t **cuts;
-
-  /* open input and output files */
-  struct stat statbuf;
-  stat(infile,&statbuf);
-  blob = malloc(statbuf.st_size);
-  int fd = open(infile,O_RDONLY);
-  read(fd,blob,statbuf.st_size);
-  close(fd);
-  bpos = blob;
-
-  fout = fopen(outfile,"w");
-  if (!fout) error("'%s': %s", outfile, strerror (errno));
-  if (fd == -1) error("'%s': %s", infile, strerror (errno));
-
-  // leave space for number of vars and clauses
-  if (opt_comments) P("p cnf                              \n");
-
-  // start reading mci file
-  conds = read_int();
-  events = read_int();
+  int *plvar, *assumps = NULL, alloc = 0, i, j, k, n;
+  int sense;
+  char *line = NULL, *name, *next, *targets, *base;
+  size_t size = 0;
+  list_t *pconds;
+  FILE *file, *out = stdout;
+
+  plvar = calloc(numpl+1, sizeof(int));
+  for (i = 1; i <= numpl; i++)
+  {
+    int *jptr = &(plcond[i]->contents);
+    pconds = plcond[i];
+    plvar[i] = ++vars;
+    cl_lit(-plvar[i]);
+    for (j = 0; j < pconds->size; j++) cl_lit(cotrl[jptr[j]]);
+    cl_end();
+    for (j = 0; j < pconds->size; j++)
+      { cl_lit(-cotrl[jptr[j]]); cl_lit(plvar[i]); cl_end(); }
+  }
+  while (solver_vars < vars) solver_vars = cdcl_newvar(solver);
 
-  preset = malloc((events+1) * sizeof(list_t*));
-  for (i = 1; i <= events; i++) l_init(preset+i);
-  cutoff = calloc((events+1) * sizeof(char),1);
-  evtrl = malloc((events+1) * sizeof(int));
-  cotrl = malloc((conds+1) * sizeof(int));
-  harmfuls = calloc(events+1, sizeof(int));
+  if (!(file = fopen(opt_targets,"r")))
+    error("'%s': %s", opt_targets, strerror (errno));
+  if (*outfile && strcmp(outfile,"-") && !(out = fopen(outfile,"w")))
+    error("'%s': %s", outfile, strerror (errno));
 
-  nqure = read_int();
-  nqure_ = abs(nqure);
-  cuts = calloc((szcuts = nqure_+1), sizeof(cut_t*));
-  while(nqure_)
+  while (getline(&line,&size,file) > 0)
   {
-    nquszcut = read_int();
-    nquszevscut = read_int();
-    cuts[nqure_] = malloc(sizeof(cut_t));
-    cuts[nqure_]->repeat = nqure;
-    cuts[nqure_]->szcut = nquszcut;
-    cuts[nqure_]->szevscut = nquszevscut;
-    cuts[nqure_]->cut = calloc(nquszcut+1, sizeof(int));
-    cuts[nqure_]->evscut = calloc(nquszevscut+1, sizeof(int));
-    for (i = 1; i <= nquszcut; i++)
-      cuts[nqure_]->cut[i] = read_int();
-    for (i = 1; i <= nquszevscut; i++)
-      cuts[nqure_]->evscut[i] = read_int();
-    nqure = read_int();
-    nqure_ = abs(nqure);
+    line[strcspn(line,"\r\n")] = 0;
+    if (!*line) continue;
+    targets = strdup(line);
+
+    /* collect the assumptions; a place that is absent from the prefix
+       makes a positive name unreachable, while a negative one on such
+       a place holds anyway, its variable being forced to false. The
+       solver decides the rest. */
+    n = 0; sense = 1;
+    for (name = line; name; name = next)
+    {
+      if ((next = strchr(name,','))) *next++ = 0;
+      if ((j = (*name == '!'))) name++;
+      if (!j && !names_has(name)) sense = 0;
+      for (k = 1; k <= numpl; k++)
+      {
+        base = bltokstr(plname[k],0,'_');
+        if (!strcmp(plname[k],name) || !strcmp(base,name))
+        {
+          if (n == alloc)
+            assumps = realloc(assumps,(alloc = 2*alloc+16) * sizeof(int));
+          assumps[n++] = j ? -plvar[k] : plvar[k];
+        }
+        free(base);
+      }
+    }
+    if (!sense || !cdcl_solve(solver,assumps,n))
+    {
+      fprintf(out,"unreachable %s\n",targets);
+      fflush(out);
+      free(targets);
+      continue;
+    }
+
+    fprintf(out,"reachable %s\n",targets);
+    for (i = 1; i <= events; i++)
+      if (!cutoff[i] && cdcl_model(solver,evtrl[i])) fprintf(out,"%d ",i);
+    fprintf(out,"0\n");
+    for (i = 1; i <= numpl; i++)
+    {
+      int *jptr = &(plcond[i]->contents);
+      for (j = 0; j < plcond[i]->size; j++)
+        if (cdcl_model(solver,cotrl[jptr[j]])) fprintf(out,"%d ",jptr[j]);
+    }
+    fprintf(out,"0\n");
+    fflush(out);
+    free(targets);
   }
 
-  // skip events and conditions in mci file
-  bconds = bpos += (events*2) * sizeof(unsigned int);
+  fclose(file);
+  if (out != stdout) fclose(out);
+  free(line); free(assumps); free(plvar);
+  cdcl_free(solver);
+  return 1;
+}
+
+/* Clauses for the conditions, in the order of the .mci file. */
+
+void encode_conditions ()
+{
+  int i, k, e, place, gen;
+  list_t *post;
+
+  l_init(&post);
   for (i = 1; i <= conds; i++)
   {
-    bpos += 4 * sizeof(unsigned int);
-    while (read_int());
-  }
+    if (!mci->co_token[i]) continue;
+    place = mci->co2pl[i];
+    gen = mci->co_pre[i];
+    l_reset(&post);
+    for (k = mci->co_postidx[i]; k < mci->co_postidx[i+1]; k++)
+      // only consider non-cutoffs for the configuration
+      if (!cutoff[e = mci->co_post[k]]) l_add(&post,e);
 
-  for (;;) {
-    harmful = read_int();
-    if (!harmful) break;
-    harmfuls[harmful] = harmful;
+    if (gen) causal(i,gen,post);
+    condition_marked(i,place,gen,post);
+    conflicts(i,post,gen);
   }
+  free(post);
+}
 
-  // read cutoff information
-  // reserve variable names only for non-cutoffs
-  if (opt_comments) P("\n");
-  while ((e = read_int()))
+/* Clauses for the goal: a deadlock or the reachability targets. */
+
+void encode_goal ()
+{
+  int i;
+
+  if (!opt_reach)
   {
-    cutoff[e] = 1;
-    if (opt_comments) P("c e%d is a cutoff\n",e);
-    read_int();
+    for (i = 1; i <= events; i++)
+      if (!opt_final || !cutoff[i]) disabled(i,preset[i]);
   }
-  for (i = 1; i <= events; i++)
+  else
   {
-    if (cutoff[i]) continue;
-    evtrl[i] = ++vars;
-    if (opt_comments) P("c event e%d ~ var %d\n",i,vars);
+    reachable();
   }
-  // dummy ints followed by number of places and transitions
-  while (read_int());
-  numpl = read_int();
-  //printf("p_reach->size: %d\n", p_reach->size);
-  //printf("numco: %d\n", conds);
-  //printf("1. nosense: %d\n", nosense);
+}
+
+int mci2sat (const char * infile, const char *outfile)
+{
+  int i, j, k, place, gen, evvars, nclauses;
+  char *present, *base, *name;
+
+  // read the mci file
+  mci = mci_read(infile,0);
+  conds = mci->numco;
+  events = mci->numev;
+
+  preset = malloc((events+1) * sizeof(list_t*));
+  for (i = 1; i <= events; i++) l_init(preset+i);
+  cutoff = calloc((events+1) * sizeof(char),1);
+  evtrl = malloc((events+1) * sizeof(int));
+  cotrl = malloc((conds+1) * sizeof(int));
+
+  // read cutoff information
+  // reserve variable names only for non-cutoffs
+  for (i = 0; i < mci->numcutoffs; i++)
+    cutoff[mci->cutoffs[2*i]] = 1;
+  for (i = 1; i <= events; i++)
+    if (!cutoff[i]) evtrl[i] = ++vars;
+  evvars = vars;
 
+  numpl = mci->numpl;
 
-  if(p_reach->size > conds-1 || n_reach->size > conds-1){
-    //printf("first return\n");
+  if (p_reach->size > conds-1 || n_reach->size > conds-1)
     return 0;
-  }
 
-  numtr = read_int();
-  read_int();
-  
+  numtr = mci->numtr;
+
   // read place names
   plcond = malloc((numpl+1) * sizeof(list_t*));
   plwanted = calloc((numpl+1) * sizeof(signed char),1);
@@ -375,40 +533,35 @@ int mci2sat (const char * infile, const char *outfile)
   for (i = 1; i <= numpl; i++) l_init(plcond+i);
   for (i = 1; i <= numpl; i++)
   {
-    idpl = read_int();
+    idpl = mci->plids[i];
+    name = mci->plname[idpl];
     char **jptr;
     jptr = &(p_reach->contents);
     for (j = 0; j < p_reach->size; j++)
-      if (!strcmp(bpos,jptr[j])) 
+      if (!strcmp(name,jptr[j])) 
       {
         plwanted[idpl] = 1;
         nosense = 0;
-        //printf("bpos: %s\n", bpos);
-        //printf("jptr[j]: %s\n", jptr[j]);
-        //printf("2. nosense: %d\n", nosense);
-
       }
       else
       {
-        char* bpos_ = bltokstr(bpos, 0, '_');
+        char* bpos_ = bltokstr(name, 0, '_');
         if (!strcmp(bpos_,jptr[j]))
         {
           plwanted[idpl] = 1;
           nosense = 0;
-          //printf("3. nosense: %d\n", nosense);
-
         }
       }
     jptr = &(n_reach->contents);
     for (j = 0; j < n_reach->size; j++)
-      if (!strcmp(bpos,jptr[j])) 
+      if (!strcmp(name,jptr[j])) 
       {
         plwanted[idpl] = -1;
         nosense = 0;
       }
       else
       {
-        char* bpos_ = bltokstr(bpos, 0, '_');
+        char* bpos_ = bltokstr(name, 0, '_');
         if (!strcmp(bpos_,jptr[j]))
         {
           plwanted[idpl] = -1;
@@ -416,104 +569,91 @@ int mci2sat (const char * infile, const char *outfile)
         }
       }
 
-    plname[idpl] = bpos;
-    if (strlen(plname[idpl]) > maxszname)
-      maxszname = strlen(plname[idpl]);
-    read_str();
+    if (opt_targets) { plwanted[idpl] = 1; nosense = 0; }
+    plname[idpl] = name;
   }
-  plinunf = calloc((maxszname*numpl)*10, sizeof(char));
-  //printf("4. nosense: %d\n", nosense);
-  if (nosense && !att){
-    //printf("second return\n");
+  if (nosense && !att)
     return 0;
-  }
-  
-  if (!opt_comments) P("p cnf                              \n");
-  /* go back and read conditions */
-  l_init(&post);
-  bpos = bconds;
 
-  //printf("num names: %d\n", numpl);
+  /* index the conditions: presets of the events, conditions of the
+     wanted places and places carrying some condition */
+  present = calloc(numpl+1, sizeof(char));
   for (i = 1; i <= conds; i++)
   {
-
-    int consumers = 0;
-    int place = read_int();
-    //printf("name num: %d\n", place);
-    if(i == 1 && place && !strstr(plinunf, plname[place]))
-    { 
-      //printf("plinunf: %s,", plinunf);
-      strcat(plinunf, plname[place]);
-    }
-    else if(place && !strstr(plinunf, plname[place]))
-    {
-      strcat(plinunf, ",");
-      strcat(plinunf, plname[place]);
-    }
-    token = read_int();
-    queried = read_int();
-    int gen = read_int();
-
-    if(!token)
-    {
-      while (read_int());
-      token = queried; // rm warning unused variables
-      continue;
-    }
-    l_reset(&post);
-    while (1) {
-      e = read_int();
-      if (!e) break;
-      consumers++;
-      l_add(preset+e,i);
-      // only consider non-cutoffs for the configuration
-      if (!cutoff[e]) l_add(&post,e);
-    }
-
-    if (gen) causal(i,gen,post);
-    condition_marked(i,place,gen,post);
-    conflicts(i,post,gen);
+    place = mci->co2pl[i];
+    gen = mci->co_pre[i];
+    if (place) present[place] = 1;
+    if (!mci->co_token[i]) continue;
+    for (k = mci->co_postidx[i]; k < mci->co_postidx[i+1]; k++)
+      l_add(preset+mci->co_post[k],i);
+    if (opt_reach && plwanted[place] && !(gen && cutoff[gen]))
+      l_add(plcond+place,i);	// collect conds with that label
   }
 
-  char **jptr, *needle;
-  jptr = &(p_reach->contents);
-  for (j = 0; j < p_reach->size; j++)
+  for (names_size = 16; names_size < 4*numpl; names_size *= 2);
+  names = calloc(names_size, sizeof(char*));
+  for (i = 1; i <= numpl; i++)
   {
-    needle = strstr(plinunf, jptr[j]);
-    if(!needle) {nosense = 1; break;}
+    if (!present[i]) continue;
+    names_add(plname[i]);
+    base = bltokstr(plname[i],0,'_');
+    if (*base && !names_has(base)) names_add(base);
+    else free(base);
   }
+  free(present);
 
-  jptr = &(n_reach->contents);
-  for (j = 0; j < n_reach->size; j++)
+  if (opt_targets)
   {
-    needle = strstr(plinunf, jptr[j]);
-    if(!needle) {nosense = 1; break;}
+    solver = cdcl_new();
+    encode_conditions();
+    return session(outfile);
   }
 
-  //printf("5. nosense: %d\n", nosense);
-  if (nosense && !att){ 
-    //printf("third return\n");
+  char **jptr;
+  jptr = &(p_reach->contents);
+  for (j = 0; j < p_reach->size; j++)
+    if (!names_has(jptr[j])) nosense = 1;
+  jptr = &(n_reach->contents);
+  for (j = 0; j < n_reach->size; j++)
+    if (!names_has(jptr[j])) nosense = 1;
+  if (nosense && !att)
     return 0;
-  }
 
-
-  if (!opt_reach)
+  /* first pass: count the variables and clauses */
+  counting = 1;
+  encode_conditions();
+  encode_goal();
+  counting = 0;
+  nclauses = clauses;
+
+  /* second pass: write the formula */
+  if (!strcmp(outfile,"-"))
+    fout = stdout;
+  else if (!(fout = fopen(outfile,"w")))
+    error("'%s': %s", outfile, strerror (errno));
+  outbuf = malloc(OUTBUF_SIZE);
+
+  P("p cnf %d %d\n",vars,clauses);
+  if (opt_comments)
   {
+    P("\n");
+    for (i = 0; i < mci->numcutoffs; i++)
+      P("c e%d is a cutoff\n",mci->cutoffs[2*i]);
     for (i = 1; i <= events; i++)
-      if (!opt_final || !cutoff[i]) disabled(i,preset[i]);
-  }
-  else
-  {
-    reachable();
+      if (!cutoff[i]) P("c event e%d ~ var %d\n",i,evtrl[i]);
   }
 
-
-  free(blob);
-
-  // insert correct number of variables and clauses
-  fseek(fout,6,SEEK_SET);
-  P("%d %d",vars,clauses);
-  fclose(fout);
+  vars = evvars;
+  clauses = 0;
+  encode_conditions();
+  encode_goal();
+  assert(clauses == nclauses);
+
+  out_flush();
+  if (fout != stdout) fclose(fout);
+  else fflush(fout);
+  free(outbuf);
+  mci_free(mci);
   return 1;
 }
 
@@ -542,7 +682,11 @@ void usage ()
   "\t-f: find final configurations\n"
   "\t-att: used to find and format attractors\n"
   "\t-r <list>, -n <list>: comma-separated list of place names\n"
-  "\t-o <filename>: output file (default: mcifile with .sat)\n"
+  "\t-t <file>: check every line of <file>, a list of places like for\n"
+  "\t   -r where names preceded by ! must be unmarked, with the built-in\n"
+  "\t   solver; the prefix is encoded only once\n"
+  "\t-o <filename>: output file, - for standard output (default: mcifile\n"
+  "\t   with .sat, standard output with -t)\n"
   "\nIf -r and/or -n are given, mci2sat will generate a formula for\n"
   "reachability checking (-r=positive targets, -n=negative targets).\n\n"
   );
@@ -580,6 +724,11 @@ int main (int argc, char ** argv)
       if (++i == argc) usage();
       find_targets(&n_reach,argv[i]);
     }
+    else if (!strcmp(argv[i],"-t"))
+    {
+      if (++i == argc) usage();
+      opt_targets = argv[i];
+    }
     else if (!strcmp(argv[i],"-o"))
     {
       if (*outfile || ++i == argc) usage();
@@ -594,8 +743,11 @@ int main (int argc, char ** argv)
 
   if (!filename) usage();
   if (opt_reach && opt_final) error("cannot use -f with -n or -p");
+  if (opt_targets && (opt_reach || opt_final || att))
+    error("cannot use -t with -r, -n, -f or -att");
+  if (opt_targets) opt_comments = 0, opt_reach = 1;
 
-  if (!*outfile)
+  if (!*outfile && !opt_targets)
   {
     int l = strlen(filename);
     if (l < 5) error("'%s': filename too short!",filename);
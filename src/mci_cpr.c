@@ -7,7 +7,7 @@
 
 void write_mci_file_cpr (char *filename)
 {
-  #define write_int(x) fwrite(&(x),sizeof(int),1,file)
+  #define write_int(x) mci_write(file,&(x),sizeof(int))
 
   FILE *file;
   place_t *pl;
@@ -18,8 +18,7 @@ void write_mci_file_cpr (char *filename)
   int ev_num = 0, sz = 0, null = 0, cum, szz = 0, once = 0,
     tmp = 0;
 
-  if (!(file = fopen(filename,"wb")))
-    nc_error("cannot write to file %s\n",filename);
+  file = mci_create(filename);
 
   write_int(unf->numco);
   write_int(unf->numev);
@@ -152,6 +151,12 @@ void write_mci_file_cpr (char *filename)
       else		write_int(null);
   }
   write_int(null);
+  /* empty unless a budget cut the run short (-timeout etc.) */
+  if (budget_hit)
+  {
+    write_int(budget_hit);
+    write_int(budget_pending);
+  }
   write_int(null);
   write_int(net->numpl);
   write_int(net->numtr);
@@ -163,15 +168,15 @@ void write_mci_file_cpr (char *filename)
   for (pl = net->places; pl; pl = pl->next)
   {
     write_int(pl->id);
-    fwrite(pl->name,strlen(pl->name)+1,1,file);
+    mci_write(file,pl->name,strlen(pl->name)+1);
   }
-  fwrite("",1,1,file);
+  mci_write(file,"",1);
   for (tr = net->transitions; tr; tr = tr->next)
   {
     write_int(tr->id);
-    fwrite(tr->name,strlen(tr->name)+1,1,file);
+    mci_write(file,tr->name,strlen(tr->name)+1);
   }
-  fwrite("",1,1,file);
+  mci_write(file,"",1);
 
-  fclose(file);
+  mci_close(file,filename);
 }
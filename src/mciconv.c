@@ -0,0 +1,99 @@
+/****************************************************************************/
+/* mciconv.c								    */
+/*									    */
+/* Converts an .mci file between the plain format and the packed one	    */
+/* (version 2). A packed file is unpacked, a plain one is packed; with -c  */
+/* the plain file is taken as a compressed prefix (ecofolder -c). A	    */
+/* streamed file (ecofolder -stream) is turned into a plain one.	    */
+/****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcipack.h"
+
+void usage ()
+{
+  fprintf(stderr,
+  "\nusage: mciconv [-c] <infile> <outfile>\n\n"
+  "  Packs a plain .mci file or unpacks a packed one.\n"
+  "  A streamed file is converted to a plain one.\n\n"
+  "  options:\n"
+  "\t-c: the plain file holds a compressed prefix (ecofolder -c).\n\n"
+  );
+  exit(1);
+}
+
+int main (int argc, char **argv)
+{
+  char *infile = NULL, *outfile = NULL, *in, *out;
+  int compressed = 0, i;
+  long size, outsize;
+  FILE *file;
+
+  for (i = 1; i < argc; i++)
+    if (!strcmp(argv[i],"-c")) compressed = 1;
+    else if (!infile) infile = argv[i];
+    else if (!outfile) outfile = argv[i];
+    else usage();
+  if (!outfile) usage();
+
+  if (!(file = fopen(infile,"rb")))
+  {
+    fprintf(stderr,"cannot read file %s\n",infile);
+    exit(1);
+  }
+  fseek(file,0,SEEK_END);
+  size = ftell(file);
+  fseek(file,0,SEEK_SET);
+  if (!(in = malloc(size ? size : 1)) || fread(in,1,size,file) != size)
+  {
+    fprintf(stderr,"cannot read file %s\n",infile);
+    exit(1);
+  }
+  fclose(file);
+
+  /* a plain file is packed straight into the output file */
+  if (!mci_is_packed(in,size) && !mci_is_streamed(in,size))
+  {
+    if (!(file = fopen(outfile,"wb+")))
+    {
+      fprintf(stderr,"cannot write to file %s\n",outfile);
+      exit(1);
+    }
+    mci_pack_begin(file,compressed);
+    mci_pack_write(in,size);
+    if (mci_pack_end())
+    {
+      fprintf(stderr,"%s: %s\n",infile,mci_pack_error);
+      exit(1);
+    }
+    if (fclose(file))
+    {
+      fprintf(stderr,"cannot write to file %s\n",outfile);
+      exit(1);
+    }
+    free(in);
+    exit(0);
+  }
+
+  if (mci_is_packed(in,size))
+    out = mci_unpack(in,size,&compressed,&outsize);
+  else
+    out = mci_unstream(in,size,&outsize);
+  if (!out)
+  {
+    fprintf(stderr,"%s: %s\n",infile,mci_pack_error);
+    exit(1);
+  }
+
+  if (!(file = fopen(outfile,"wb")) || fwrite(out,1,outsize,file) != outsize
+      || fclose(file))
+  {
+    fprintf(stderr,"cannot write to file %s\n",outfile);
+    exit(1);
+  }
+  free(in); free(out);
+  exit(0);
+}
@@ -2,13 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-typedef struct cut_t
-{
-  int repeat;
-  int szcut, szevscut;
-  int *cut;
-  int *evscut;
-} cut_t;
+#include "mciread.h"
 
 /**
  * @brief function that reads sequentially an .mci file format
@@ -17,30 +11,21 @@ typedef struct cut_t
  */
 void read_mci_file_ev (char *mcifile, char* evevfile)
 {
-  #define read_int(x) fread(&(x),sizeof(int),1,mcif)
-  /* define a micro substitution to read_int.
-    &(x) - is the pointer to a block of memory with a minimum
-            size of "sizeof(int)*1" bytes.
-    sizeof(int) - is the size in bytes of each element to be read.
-    1 - is the number of elements, each one with a size of 
-        "sizeof(int)" bytes.
-    file - is the pointer to a FILE object that specifies an input stream.
-  */
-
-  FILE *mcif, *evevf;
-  int nqure, nqure_, nquszcut, nquszevscut, szcuts,
-    numco, numev, numpl, numtr, idpl, idtr, sz, i, j, prevalue, value, nconfs = 1;
-  int pre_ev, post_ev, cutoff, harmful, dummy = 0, m_repeat = 0;
-  int *co2pl, *ev2tr, *tokens, *queries_co, *harmfuls;
-  char **plname, **trname, *c;
-  cut_t **cuts;
+  FILE *evevf;
+  mci_t *mci;
+  int numev, i, j, prevalue, value, nconfs = 1, dummy = 0;
+  int *ev2tr;
+  char **trname;
 
-
-  if (!(mcif = fopen(mcifile,"rb")) || !strstr(mcifile, ".mci"))
+  if (!strstr(mcifile, ".mci"))
   {
     fprintf(stderr,"cannot read file %s\n",mcifile);
     exit(1);
   }
+  mci = mci_read(mcifile,0);
+  numev = mci->numev;
+  ev2tr = mci->ev2tr;
+  trname = mci->trname;
 
   if (evevfile)
   {
@@ -51,51 +36,16 @@ void read_mci_file_ev (char *mcifile, char* evevfile)
     }
   }
 
-  read_int(numco); // read from input file the total number of conditions.
-  read_int(numev); // read from input file the total number of events.
-
-  co2pl = malloc((numco+1) * sizeof(int)); // reserve empty memory for the total number 
-                                           // conditions.
-  tokens = malloc((numco+1) * sizeof(int)); // reserve the same amount of empty memory
-                                            // to save the particular tokens' conditions.
-  queries_co = malloc((numco+1) * sizeof(int)); // reserve the same amount of empty memory
-                                            // to save the particular queries' conditions.
-  int (*queries_ev)[numev+1] = calloc(numev+1, sizeof *queries_ev); // reserve the same amount of empty memory
-                                            // to save the particular queries' events.
-  ev2tr = malloc((numev+1) * sizeof(int)); // reserve empty memory for the total number 
-                                           // events.
-
-  harmfuls = calloc(numev+1, sizeof(int));
-  int (*co_postsets)[numev+1] = calloc(numco+1, sizeof *co_postsets);
-                                           // conditions' postsets to detect conflicts in events.
-  if (co_postsets == NULL) {
-    fprintf(stderr, "Memory allocation failed.\n");
-  }
-  
-  read_int(nqure);
-  nqure_ = abs(nqure);
-  cuts = calloc((szcuts = nqure_+1), sizeof(cut_t*));
-  if(nqure_ && !m_repeat)
-    dummy = nqure_;
-  else if(nqure_ && (m_repeat > szcuts-1 || m_repeat < 0))
-    m_repeat = -1;
-  while(nqure_)
+  if(evevfile)
   {
-    read_int(nquszcut);
-    read_int(nquszevscut);
-    cuts[nqure_] = malloc(sizeof(cut_t));
-    cuts[nqure_]->repeat = nqure;
-    cuts[nqure_]->szcut = nquszcut;
-    cuts[nqure_]->szevscut = nquszevscut;
-    cuts[nqure_]->cut = calloc(nquszcut+1, sizeof(int));
-    cuts[nqure_]->evscut = calloc(nquszevscut+1, sizeof(int));
-    for (i = 1; i <= nquszcut; i++)
-      read_int(cuts[nqure_]->cut[i]);
-    for (i = 1; i <= nquszevscut; i++)
-      read_int(cuts[nqure_]->evscut[i]);
-    read_int(nqure);
-    nqure_ = abs(nqure);
+    /* one row per configuration, each one ended by a 0 */
+    while (fscanf(evevf," %d",&value) != EOF)
+      if (value == 0) nconfs++;
+    rewind(evevf);
   }
+  int (*queries_ev)[numev+2] = calloc(nconfs+1, sizeof *queries_ev); // reserve the same amount of empty memory
+                                            // to save the particular queries' events.
+  nconfs = 1;
 
   if(evevfile)
   {
@@ -112,67 +62,6 @@ void read_mci_file_ev (char *mcifile, char* evevfile)
       }
     nconfs--;
   }
-  
-  for (i = 1; i <= numev; i++){
-    read_int(ev2tr[i]);
-    read_int(dummy);
-  }
-
-  for (i = 1; i <= numco; i++)
-  {
-    read_int(co2pl[i]);
-    read_int(tokens[i]);
-    read_int(queries_co[i]);
-    read_int(pre_ev);
-    do {
-      read_int(post_ev);
-    } while (post_ev); // if post_ev is not null.
-  }
-  
-  for (;;) {
-    read_int(harmful);
-    if (!harmful) break;
-    harmfuls[harmful] = harmful;
-  }
-  
-  for (;;) {
-    read_int(cutoff);
-    if (!cutoff) break;
-#ifdef CUTOFF
-    printf("  e%d [style=filled];\n",cutoff);
-#endif
-    read_int(dummy);
-#ifdef CUTOFF
-    printf("  e%d [style=dashed];\n",dummy);
-#endif
-  }
-
-  do { read_int(dummy); } while(dummy);
-  read_int(numpl);
-  read_int(numtr);
-  read_int(sz);
-
-  plname = malloc((numpl+2) * sizeof(char*));
-  trname = malloc((numtr+2) * sizeof(char*));
-
-  for (i = 1; i <= numpl+1; i++) plname[i] = malloc(sz+1);
-  for (i = 1; i <= numtr+1; i++) trname[i] = malloc(sz+1);
-
-  for (i=1; i <= numpl; i++)
-  {
-    read_int(idpl);
-    c = plname[idpl];
-    do { fread(c,1,1,mcif); } while (*c++);
-  }
-  fread(c,1,1,mcif);
-
-  for (i=1; i <= numtr; i++)
-  {
-    read_int(idtr);
-    c = trname[idtr];
-    do { fread(c,1,1,mcif); } while (*c++);
-  }
-  fread(c,1,1,mcif);
 
   /* Applying the labelling function to each event */
   for (i = 1; i <= nconfs; i++)
@@ -191,7 +80,7 @@ void read_mci_file_ev (char *mcifile, char* evevfile)
     printf("\n");
   }
   
-  fclose(mcif);
+  mci_free(mci);
   fclose(evevf);
 }
 
@@ -0,0 +1,907 @@
+/****************************************************************************/
+/* mcipack.c								    */
+/*									    */
+/* Conversion between the plain .mci format and the packed one (version  */
+/* 2, see mcipack.h). The packer takes the plain file in pieces and      */
+/* writes the sections as it goes, the unpacker works on whole files in  */
+/* memory, and the conversion is exact: unpacking a packed file gives    */
+/* back the plain file it was made from, byte for byte. A streamed file  */
+/* is turned into the plain file ecofolder would have written at the end */
+/* of the run.								    */
+/****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "mcipack.h"
+
+#define MCI_HEADER 40		/* bytes before the section entries */
+#define MCI_ENTRY 20		/* bytes per section entry */
+
+const char *mci_pack_error;
+
+/* A growing output buffer; errors in the input jump back to the
+   function that set mci_pack_jmp. */
+
+typedef struct mcibuf_t
+{
+  unsigned char *data;
+  long size, alloc;
+} mcibuf_t;
+
+typedef struct mcivec_t
+{
+  int *data;
+  long size, alloc;
+} mcivec_t;
+
+jmp_buf mci_pack_jmp;
+static mcibuf_t mci_out;
+
+static void mci_fail (const char *msg)
+{
+  mci_pack_error = msg;
+  longjmp(mci_pack_jmp,1);
+}
+
+static void put_bytes (const void *ptr, long n)
+{
+  if (mci_out.size + n > mci_out.alloc)
+  {
+    long alloc = mci_out.alloc ? mci_out.alloc : 4096;
+    while (alloc < mci_out.size + n) alloc *= 2;
+    if (!(mci_out.data = realloc(mci_out.data,alloc)))
+    {
+      fprintf(stderr,"out of memory\n");
+      exit(1);
+    }
+    mci_out.alloc = alloc;
+  }
+  memcpy(mci_out.data + mci_out.size,ptr,n);
+  mci_out.size += n;
+}
+
+static void put_word (unsigned long long v, int bytes)
+{
+  unsigned char b[8];
+  int i;
+
+  for (i = 0; i < bytes; i++, v >>= 8) b[i] = v & 0xff;
+  put_bytes(b,bytes);
+}
+
+static void put_uint (unsigned long long v)
+{
+  unsigned char b[10];
+  int n = 0;
+
+  while (v >= 0x80) { b[n++] = (v & 0x7f) | 0x80; v >>= 7; }
+  b[n++] = v;
+  put_bytes(b,n);
+}
+
+static void put_int (long long v)
+{
+  put_uint(((unsigned long long) v << 1) ^ (unsigned long long) (v >> 63));
+}
+
+static void put_plain (int v)
+{
+  put_bytes(&v,sizeof(int));
+}
+
+static void vec_put (mcivec_t *v, int x)
+{
+  if (v->size == v->alloc)
+  {
+    v->alloc = v->alloc ? 2 * v->alloc : 1024;
+    if (!(v->data = realloc(v->data,v->alloc * sizeof(int))))
+    {
+      fprintf(stderr,"out of memory\n");
+      exit(1);
+    }
+  }
+  v->data[v->size++] = x;
+}
+
+static void vec_free (mcivec_t *v)
+{
+  free(v->data);
+  memset(v,0,sizeof(mcivec_t));
+}
+
+static unsigned long long get_word (const unsigned char *p, int bytes)
+{
+  unsigned long long v = 0;
+
+  while (bytes--) v = (v << 8) | p[bytes];
+  return v;
+}
+
+static unsigned long long get_uint (mcicur_t *cur)
+{
+  unsigned long long v = 0;
+  int shift;
+
+  for (shift = 0; shift < 64; shift += 7)
+  {
+    if (cur->pos == cur->end) mci_fail("truncated section");
+    v |= (unsigned long long) (*cur->pos & 0x7f) << shift;
+    if (!(*cur->pos++ & 0x80)) return v;
+  }
+  mci_fail("bad number");
+  return 0;
+}
+
+long long mci_get_int (mcicur_t *cur)
+{
+  unsigned long long v = get_uint(cur);
+  return (long long) ((v >> 1) ^ -(v & 1));
+}
+
+/* A count read from a section: every item takes at least one byte. */
+
+long mci_get_count (mcicur_t *cur)
+{
+  unsigned long long n = get_uint(cur);
+  if (n > cur->end - cur->pos) mci_fail("truncated section");
+  return n;
+}
+
+static int get_plain (mcicur_t *cur)
+{
+  int v;
+
+  if (cur->end - cur->pos < sizeof(int)) mci_fail("unexpected end of file");
+  memcpy(&v,cur->pos,sizeof(int));
+  cur->pos += sizeof(int);
+  return v;
+}
+
+const char* mci_get_str (mcicur_t *cur)
+{
+  const unsigned char *str = cur->pos, *end = memchr(str,0,cur->end - str);
+  if (!end) mci_fail("unexpected end of file");
+  cur->pos = end + 1;
+  return (const char*) str;
+}
+
+/* The CRC-32 of n bytes following those whose CRC is 'crc' (0 at the
+   start). */
+
+static unsigned int crc32 (unsigned int crc, const unsigned char *p, long n)
+{
+  static unsigned int table[256];
+  unsigned int c;
+  int i, k;
+
+  if (!table[1])
+    for (i = 0; i < 256; i++)
+    {
+      for (c = i, k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+  crc ^= 0xffffffff;
+  while (n--) crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return crc ^ 0xffffffff;
+}
+
+int mci_is_packed (const char *buf, long size)
+{
+  return size >= 4 && !memcmp(buf,MCI_MAGIC,4);
+}
+
+/*****************************************************************************/
+/* The packer reads the plain file one integer at a time (one byte at a    */
+/* time in the names) and keeps its place in the file in pk.state. Lists   */
+/* whose length comes first in the packed file are held in pk.list until   */
+/* the 0 that ends them. The output is written out whenever it has grown  */
+/* by MCI_FLUSH bytes, so that only the header is kept back until the end. */
+
+#define MCI_FLUSH 65536
+
+enum { PK_COUNTS, PK_QUERY, PK_QSIZES, PK_QNODES, PK_EVENTS, PK_CONDITION,
+       PK_GROUP, PK_PRE, PK_POST, PK_HARMFUL, PK_CUTOFFS, PK_BUDGET,
+       PK_SIZES, PK_ID, PK_NAME, PK_NAMES_END, PK_DONE };
+
+static struct
+{
+  FILE *file;
+  int compressed, failed, state;
+  int head[5];		/* numco, numev, numpl, numtr, maxname */
+  int nhead;
+  long secoff[MCI_SECTIONS+2], written;
+  long left;		/* items left in the current part */
+  long szcut, szevscut;	/* of the current query cut */
+  int c, sec, prev, prev_pre, prev_group;
+  unsigned char word[sizeof(int)];
+  int wlen;
+  mcivec_t list;
+} pk;
+
+static long pk_offset ()
+{
+  return pk.written + mci_out.size;
+}
+
+static void pk_flush ()
+{
+  if (mci_out.size && fwrite(mci_out.data,1,mci_out.size,pk.file)
+		      != mci_out.size)
+    mci_fail("cannot write the file");
+  pk.written += mci_out.size;
+  mci_out.size = 0;
+}
+
+static void pk_section (int sec, int state)
+{
+  pk.secoff[sec] = pk_offset();
+  pk.state = state;
+  pk.list.size = 0;
+}
+
+static void pk_condition ()
+{
+  if (pk.c > pk.head[0])
+    pk_section(MCI_SEC_HARMFUL,PK_HARMFUL);
+  else if (pk.compressed)
+  {
+    pk.list.size = 0;
+    pk.state = PK_GROUP;
+  }
+  else
+  {
+    pk.left = 3;
+    pk.state = PK_CONDITION;
+  }
+}
+
+static void pk_conditions ()
+{
+  pk_section(MCI_SEC_CONDITIONS,PK_CONDITION);
+  pk.c = 1;
+  pk_condition();
+}
+
+static void pk_events ()
+{
+  pk_section(MCI_SEC_EVENTS,PK_EVENTS);
+  if (!(pk.left = 2L * pk.head[1])) pk_conditions();
+}
+
+static void pk_names (int sec)
+{
+  pk_section(pk.sec = sec,PK_ID);
+  pk.left = pk.head[sec == MCI_SEC_PLACES ? 2 : 3];
+  if (!pk.left) pk.state = PK_NAMES_END;
+}
+
+/* the items of pk.list as differences to the previous one, the first
+   to 'prev' */
+
+static void pk_deltas (int prev)
+{
+  long i;
+
+  for (i = 0; i < pk.list.size; prev = pk.list.data[i++])
+    put_int((long long) pk.list.data[i] - prev);
+}
+
+static void pack_int (int v)
+{
+  long i, n;
+
+  switch (pk.state)
+  {
+    case PK_COUNTS:
+      if (v < 0) mci_fail("not an mci file");
+      pk.head[pk.nhead++] = v;
+      if (pk.nhead == 2) pk_section(MCI_SEC_QUERIES,PK_QUERY);
+      break;
+
+    /* query cuts, ended by a repeat of 0 */
+    case PK_QUERY:
+      put_int(v);
+      if (v) { pk.left = 2; pk.state = PK_QSIZES; }
+      else pk_events();
+      break;
+    case PK_QSIZES:
+      if (v < 0) mci_fail("not an mci file");
+      put_uint(v);
+      if (pk.left-- == 2) { pk.szcut = v; break; }
+      pk.szevscut = v;
+      pk.left = pk.szcut + v;
+      pk.prev = 0;
+      pk.state = pk.left ? PK_QNODES : PK_QUERY;
+      break;
+    case PK_QNODES:
+      if (pk.left == pk.szevscut) pk.prev = 0;
+      put_int((long long) v - pk.prev);
+      pk.prev = v;
+      if (!--pk.left) pk.state = PK_QUERY;
+      break;
+
+    case PK_EVENTS:
+      put_int(v);
+      if (!--pk.left) pk_conditions();
+      break;
+
+    /* conditions: the generating event is stored as a difference to the
+       previous one, the consumers as differences to it */
+    case PK_CONDITION:
+      put_int(v);
+      if (!--pk.left) pk.state = PK_PRE;
+      break;
+    case PK_GROUP:
+      if (v || pk.list.size % 4) { vec_put(&pk.list,v); break; }
+      put_uint(n = pk.list.size / 4);
+      if (pk.c + n - 1 > pk.head[0]) mci_fail("too many conditions");
+      for (i = 0; i < pk.list.size; i += 4)
+      {
+	put_int(pk.list.data[i]);
+	put_int(pk.list.data[i+1]);
+	put_int(pk.list.data[i+2]);
+	put_int((long long) pk.list.data[i+3] - pk.prev_group);
+	pk.prev_group = pk.list.data[i+3];
+      }
+      if (n) pk.c += n - 1;
+      pk.state = PK_PRE;
+      break;
+    case PK_PRE:
+      put_int((long long) v - pk.prev_pre);
+      pk.prev_pre = v;
+      pk.list.size = 0;
+      pk.state = PK_POST;
+      break;
+    case PK_POST:
+      if (v) { vec_put(&pk.list,v); break; }
+      put_uint(pk.list.size);
+      pk_deltas(pk.prev_pre);
+      pk.c++;
+      pk_condition();
+      break;
+
+    case PK_HARMFUL:
+      if (v) { vec_put(&pk.list,v); break; }
+      put_uint(pk.list.size);
+      pk_deltas(0);
+      pk_section(MCI_SEC_CUTOFFS,PK_CUTOFFS);
+      break;
+
+    /* pairs of cutoff and corresponding event, then whatever comes
+       before the next 0 (nothing, as written by ecofolder, unless a
+       budget cut the run short) */
+    case PK_CUTOFFS:
+      if (v || pk.list.size % 2) { vec_put(&pk.list,v); break; }
+      put_uint(pk.list.size / 2);
+      for (pk.prev = i = 0; i < pk.list.size; i += 2)
+      {
+	put_int((long long) pk.list.data[i] - pk.prev);
+	put_int(pk.list.data[i+1]);
+	pk.prev = pk.list.data[i];
+      }
+      pk.list.size = 0;
+      pk.state = PK_BUDGET;
+      break;
+    case PK_BUDGET:
+      if (v) { vec_put(&pk.list,v); break; }
+      put_uint(pk.list.size);
+      for (i = 0; i < pk.list.size; i++) put_int(pk.list.data[i]);
+      pk.state = PK_SIZES;
+      break;
+
+    case PK_SIZES:
+      if (v < 0 && pk.nhead < 4) mci_fail("not an mci file");
+      pk.head[pk.nhead++] = v;
+      if (pk.nhead == 5) pk_names(MCI_SEC_PLACES);
+      break;
+    case PK_ID:
+      put_int(v);
+      pk.state = PK_NAME;
+      break;
+  }
+}
+
+/* a byte of the names, which are stored as they are */
+
+static void pack_byte (unsigned char b)
+{
+  switch (pk.state)
+  {
+    case PK_NAME:
+      put_bytes(&b,1);
+      if (!b) pk.state = --pk.left ? PK_ID : PK_NAMES_END;
+      break;
+    case PK_NAMES_END:
+      if (b) mci_fail("not an mci file");
+      if (pk.sec == MCI_SEC_PLACES) pk_names(MCI_SEC_TRANSITIONS);
+      else pk_section(MCI_SECTIONS+1,PK_DONE);
+      break;
+    case PK_DONE:
+      mci_fail("trailing data after the names");
+  }
+}
+
+void mci_pack_begin (FILE *file, int compressed)
+{
+  int i;
+
+  memset(&pk,0,sizeof(pk));
+  memset(&mci_out,0,sizeof(mci_out));
+  pk.file = file;
+  pk.compressed = compressed;
+  pk.state = PK_COUNTS;
+
+  /* room for the header */
+  for (i = MCI_HEADER + MCI_SECTIONS * MCI_ENTRY; i; i--) put_bytes("",1);
+}
+
+void mci_pack_write (const void *ptr, long n)
+{
+  const unsigned char *p = ptr;
+  int v;
+
+  if (pk.failed) return;
+  if (setjmp(mci_pack_jmp))
+  {
+    pk.failed = 1;
+    return;
+  }
+
+  for (; n--; p++)
+  {
+    if (pk.state >= PK_NAME)
+      pack_byte(*p);
+    else
+    {
+      pk.word[pk.wlen++] = *p;
+      if (pk.wlen < sizeof(int)) continue;
+      memcpy(&v,pk.word,sizeof(int));
+      pk.wlen = 0;
+      pack_int(v);
+    }
+    if (mci_out.size >= MCI_FLUSH) pk_flush();
+  }
+}
+
+int mci_pack_end ()
+{
+  unsigned char buf[MCI_FLUSH];
+  unsigned int crc = 0;
+  long n;
+  int sec;
+
+  if (setjmp(mci_pack_jmp))
+    pk.failed = 1;
+  else if (!pk.failed)
+  {
+    if (pk.state != PK_DONE) mci_fail("unexpected end of file");
+    pk_flush();
+
+    put_bytes(MCI_MAGIC,4);
+    put_word(MCI_VERSION,4);
+    put_word(0,4);
+    put_word(pk.compressed ? MCI_PACKED_COMPRESSED : 0,4);
+    for (n = 0; n < 5; n++) put_word(pk.head[n],4);
+    put_word(MCI_SECTIONS,4);
+    for (sec = 1; sec <= MCI_SECTIONS; sec++)
+    {
+      put_word(sec,4);
+      put_word(pk.secoff[sec],8);
+      put_word(pk.secoff[sec+1] - pk.secoff[sec],8);
+    }
+
+    /* the checksum covers the header after it and the sections, which
+       are read back from the file */
+    crc = crc32(crc,mci_out.data + 12,mci_out.size - 12);
+    if (fseek(pk.file,0,SEEK_SET) ||
+	fwrite(mci_out.data,1,mci_out.size,pk.file) != mci_out.size ||
+	fseek(pk.file,mci_out.size,SEEK_SET))
+      mci_fail("cannot write the file");
+    while ((n = fread(buf,1,sizeof(buf),pk.file)) > 0) crc = crc32(crc,buf,n);
+    if (ferror(pk.file)) mci_fail("cannot read back the file");
+    mci_out.size = 0;
+    put_word(crc,4);
+    if (fseek(pk.file,8,SEEK_SET) || fwrite(mci_out.data,1,4,pk.file) != 4)
+      mci_fail("cannot write the file");
+  }
+
+  vec_free(&pk.list);
+  free(mci_out.data);
+  memset(&mci_out,0,sizeof(mci_out));
+  return pk.failed ? -1 : 0;
+}
+
+/*****************************************************************************/
+
+void mci_sections (const char *packed, long size, mcihead_t *head)
+{
+  const unsigned char *p = (const unsigned char*) packed, *entry;
+  unsigned long long off, len;
+  long nsec;
+  int id;
+
+  if (size < MCI_HEADER || !mci_is_packed(packed,size))
+    mci_fail("not a packed mci file");
+  if (get_word(p+4,4) != MCI_VERSION) mci_fail("unknown version");
+  if (get_word(p+8,4) != crc32(0,p+12,size-12)) mci_fail("checksum mismatch");
+  head->compressed = get_word(p+12,4) & MCI_PACKED_COMPRESSED;
+  head->numco = get_word(p+16,4);
+  head->numev = get_word(p+20,4);
+  head->numpl = get_word(p+24,4);
+  head->numtr = get_word(p+28,4);
+  head->maxname = get_word(p+32,4);
+  nsec = get_word(p+36,4);
+  if (head->numco < 0 || head->numev < 0 || head->numpl < 0 ||
+      head->numtr < 0 || nsec > (size - MCI_HEADER) / MCI_ENTRY)
+    mci_fail("bad header");
+
+  /* sections may be added in later versions, unknown ones are skipped */
+  memset(head->sec,0,sizeof(head->sec));
+  for (entry = p + MCI_HEADER; nsec--; entry += MCI_ENTRY)
+  {
+    id = get_word(entry,4);
+    off = get_word(entry+4,8);
+    len = get_word(entry+12,8);
+    if (off > size || len > size - off) mci_fail("bad header");
+    if (id < 1 || id > MCI_SECTIONS) continue;
+    head->sec[id].pos = p + off;
+    head->sec[id].end = p + off + len;
+  }
+  for (id = 1; id <= MCI_SECTIONS; id++)
+    if (!head->sec[id].pos) mci_fail("missing section");
+}
+
+char* mci_unpack (const char *packed, long size, int *compressed, long *plain_size)
+{
+  mcihead_t head;
+  mcicur_t *sec = head.sec, *cur;
+  long n, k;
+  int numco, numev, numpl, numtr, c, v, prev_pre, prev_group, i, id;
+
+  memset(&mci_out,0,sizeof(mci_out));
+  if (setjmp(mci_pack_jmp))
+  {
+    free(mci_out.data);
+    return NULL;
+  }
+
+  mci_sections(packed,size,&head);
+  *compressed = head.compressed;
+  numco = head.numco;
+  numev = head.numev;
+  numpl = head.numpl;
+  numtr = head.numtr;
+
+  put_plain(numco);
+  put_plain(numev);
+
+  cur = &sec[MCI_SEC_QUERIES];
+  while ((v = mci_get_int(cur)))
+  {
+    long szcut = mci_get_count(cur), szevscut = mci_get_count(cur);
+    put_plain(v);
+    put_plain(szcut);
+    put_plain(szevscut);
+    for (v = 0, k = szcut + szevscut; k; k--)
+    {
+      if (k == szevscut) v = 0;
+      put_plain(v += mci_get_int(cur));
+    }
+  }
+  put_plain(0);
+
+  cur = &sec[MCI_SEC_EVENTS];
+  for (i = 2 * numev; i; i--) put_plain(mci_get_int(cur));
+
+  cur = &sec[MCI_SEC_CONDITIONS];
+  for (prev_pre = prev_group = 0, c = 1; c <= numco; c++)
+  {
+    if (*compressed)
+    {
+      n = mci_get_count(cur);
+      for (k = 0; k < n; k++)
+      {
+	put_plain(mci_get_int(cur));
+	put_plain(mci_get_int(cur));
+	put_plain(mci_get_int(cur));
+	put_plain(prev_group += mci_get_int(cur));
+      }
+      put_plain(0);
+      if (n) c += n - 1;
+    }
+    else
+    {
+      put_plain(mci_get_int(cur));
+      put_plain(mci_get_int(cur));
+      put_plain(mci_get_int(cur));
+    }
+    put_plain(v = prev_pre += mci_get_int(cur));
+    for (n = mci_get_count(cur); n; n--) put_plain(v += mci_get_int(cur));
+    put_plain(0);
+  }
+
+  cur = &sec[MCI_SEC_HARMFUL];
+  for (v = 0, n = mci_get_count(cur); n; n--) put_plain(v += mci_get_int(cur));
+  put_plain(0);
+
+  cur = &sec[MCI_SEC_CUTOFFS];
+  for (v = 0, n = mci_get_count(cur); n; n--)
+  {
+    put_plain(v += mci_get_int(cur));
+    put_plain(mci_get_int(cur));
+  }
+  put_plain(0);
+  for (n = mci_get_count(cur); n; n--) put_plain(mci_get_int(cur));
+  put_plain(0);
+
+  put_plain(numpl);
+  put_plain(numtr);
+  put_plain(head.maxname);
+  for (id = MCI_SEC_PLACES; id <= MCI_SEC_TRANSITIONS; id++)
+  {
+    const char *name;
+    cur = &sec[id];
+    for (i = id == MCI_SEC_PLACES ? numpl : numtr; i; i--)
+    {
+      put_plain(mci_get_int(cur));
+      name = mci_get_str(cur);
+      put_bytes(name,(const char*) cur->pos - name);
+    }
+    put_bytes("",1);
+  }
+
+  *plain_size = mci_out.size;
+  return (char*) mci_out.data;
+}
+
+/*****************************************************************************/
+
+/* conditions (place, token, queried, generating event), events
+   (transition, start of the preset), presets, cutoff pairs, harmful
+   events and, per event, the kind and the final number */
+static mcivec_t mci_co, mci_ev, mci_pre, mci_cut, mci_harm, mci_fin;
+
+static void unstream_free ()
+{
+  vec_free(&mci_co); vec_free(&mci_ev); vec_free(&mci_pre);
+  vec_free(&mci_cut); vec_free(&mci_harm); vec_free(&mci_fin);
+}
+
+/* Whether the next n integers are in the file; a record cut short at the
+   end of the file is ignored. */
+
+static int have (mcicur_t *cur, long n)
+{
+  return (cur->end - cur->pos) / sizeof(int) >= n;
+}
+
+/* Whether the whole trailer is in the file; an interrupted run may have
+   written only part of it. */
+
+static int complete_trailer (mcicur_t cur)
+{
+  int n, k, i;
+
+  for (i = 0; i < 2; i++)
+  {
+    if (!have(&cur,2 - i)) return 0;
+    if (!i) get_plain(&cur);
+    if ((n = get_plain(&cur)) < 0 || !have(&cur,n)) return 0;
+    cur.pos += n * sizeof(int);
+  }
+  for (;;)
+  {
+    if (!have(&cur,1)) return 0;
+    if (!get_plain(&cur)) break;
+    if (!have(&cur,2)) return 0;
+    n = get_plain(&cur); k = get_plain(&cur);
+    if (n < 0 || k < 0 || !have(&cur,(long) n + k)) return 0;
+    cur.pos += ((long) n + k) * sizeof(int);
+  }
+  do if (!have(&cur,1)) return 0; while (get_plain(&cur));
+  return 1;
+}
+
+static int get_event (mcicur_t *cur, int zero)
+{
+  int e = get_plain(cur);
+  if (e < !zero || e > mci_ev.size / 2) mci_fail("event out of range");
+  return e;
+}
+
+int mci_is_streamed (const char *buf, long size)
+{
+  return size >= 4 && !memcmp(buf,MCI_STREAM_MAGIC,4);
+}
+
+char* mci_unstream (const char *streamed, long size, long *plain_size)
+{
+  mcicur_t in = { (const unsigned char*) streamed,
+		  (const unsigned char*) streamed + size };
+  const unsigned char *names, *names_end, *queries = NULL,
+		      *budget = NULL;
+  int numpl, numtr, maxname, numco, numev, stop = 0, trailer = 0;
+  int tag, n, e, c, k, i, *kind, *fin, *order, *postidx, *post;
+
+  memset(&mci_out,0,sizeof(mci_out));
+  if (setjmp(mci_pack_jmp))
+  {
+    unstream_free();
+    free(mci_out.data);
+    return NULL;
+  }
+
+  if (!mci_is_streamed(streamed,size)) mci_fail("not a streamed mci file");
+  in.pos += 4;
+  if (get_plain(&in) != MCI_STREAM_VERSION) mci_fail("unknown version");
+  numpl = get_plain(&in);
+  numtr = get_plain(&in);
+  maxname = get_plain(&in);
+  if (numpl < 0 || numtr < 0) mci_fail("not an mci file");
+  names = in.pos;
+  for (i = numpl; i; i--) { get_plain(&in); mci_get_str(&in); }
+  mci_get_str(&in);
+  for (i = numtr; i; i--) { get_plain(&in); mci_get_str(&in); }
+  mci_get_str(&in);
+  names_end = in.pos;
+
+  while (!trailer && have(&in,1))
+  {
+    const unsigned char *rec = in.pos;
+    switch (tag = get_plain(&in))
+    {
+      case MCI_REC_CONDITION:
+	if (!have(&in,4)) break;
+	for (i = 0; i < 3; i++) vec_put(&mci_co,get_plain(&in));
+	vec_put(&mci_co,get_event(&in,1));
+	continue;
+      case MCI_REC_EVENT:
+	if (!have(&in,2)) break;
+	memcpy(&n,in.pos + sizeof(int),sizeof(int));
+	if (n < 0) mci_fail("bad record");
+	if (!have(&in,2 + (long) n)) break;
+	vec_put(&mci_ev,get_plain(&in));
+	vec_put(&mci_ev,mci_pre.size);
+	get_plain(&in);
+	for (; n; n--)
+	{
+	  if ((c = get_plain(&in)) < 1 || c > mci_co.size / 4)
+	    mci_fail("condition out of range");
+	  vec_put(&mci_pre,c);
+	}
+	continue;
+      case MCI_REC_CUTOFF:
+	if (!have(&in,2)) break;
+	vec_put(&mci_cut,get_event(&in,0));
+	vec_put(&mci_cut,get_event(&in,1));
+	continue;
+      case MCI_REC_HARMFUL:
+	if (!have(&in,1)) break;
+	vec_put(&mci_harm,get_event(&in,0));
+	continue;
+      case MCI_REC_END:
+	if (!complete_trailer(in)) break;
+	trailer = 1;
+	continue;
+      default:
+	mci_fail("bad record");
+    }
+    in.pos = rec;
+    break;
+  }
+  numco = mci_co.size / 4;
+  numev = mci_ev.size / 2;
+  vec_put(&mci_ev,0);
+  vec_put(&mci_ev,mci_pre.size);
+
+  /* the kind of every event: 1 cutoff, 2 harmful, 3 queried; the final
+     values of the query flags are in the trailer */
+  for (e = 0; e < 2 * (numev + 1); e++) vec_put(&mci_fin,0);
+  kind = mci_fin.data; fin = kind + numev + 1;
+  for (i = 0; i < mci_cut.size; i += 2) kind[mci_cut.data[i]] = 1;
+  for (i = 0; i < mci_harm.size; i++) kind[mci_harm.data[i]] = 2;
+  if (trailer)
+  {
+    stop = get_event(&in,1);
+    for (n = get_plain(&in); n > 0; n--) kind[get_event(&in,0)] |= 4;
+    for (c = 1; c <= numco; c++) mci_co.data[4*c-2] = 0;
+    for (n = get_plain(&in); n > 0; n--)
+    {
+      if ((c = get_plain(&in)) < 1 || c > numco) mci_fail("condition out of range");
+      mci_co.data[4*c-2] = 1;
+    }
+    queries = in.pos;
+    while (get_plain(&in))
+    {
+      n = get_plain(&in); k = get_plain(&in);
+      if (n < 0 || k < 0) mci_fail("bad query cut");
+      for (; n; n--) get_plain(&in);
+      for (; k; k--) get_event(&in,1);
+    }
+    for (budget = in.pos; get_plain(&in); );
+    if (in.pos != in.end) mci_fail("trailing data after the trailer");
+  }
+
+  /* Number the events as write_mci_file does: the others in the order
+     they were added, then the harmful events and the cutoffs, the latest
+     first, and at last the event the run stopped at. */
+  for (k = 0, e = 1; e <= numev; e++)
+    if (!(kind[e] & 3) && e != stop) fin[e] = ++k;
+  for (i = mci_harm.size - 1; i >= 0; i--)
+    if (!fin[e = mci_harm.data[i]]) fin[e] = ++k;
+  for (i = mci_cut.size - 2; i >= 0; i -= 2)
+    if (!fin[e = mci_cut.data[i]]) fin[e] = ++k;
+  if (stop && !fin[stop]) fin[stop] = ++k;
+
+  /* the events by final number, the consumers of the conditions, the
+     latest first as in the postsets of the unfolding */
+  for (e = 0; e <= numev; e++) vec_put(&mci_fin,0);
+  for (c = 0; c <= numco + 1; c++) vec_put(&mci_fin,0);
+  for (i = 0; i < mci_pre.size; i++) vec_put(&mci_fin,0);
+  kind = mci_fin.data; fin = kind + numev + 1;
+  order = fin + numev + 1; postidx = order + numev + 1;
+  post = postidx + numco + 2;
+  for (e = 1; e <= numev; e++) order[fin[e]] = e;
+  for (i = 0; i < mci_pre.size; i++) postidx[mci_pre.data[i]+1]++;
+  for (c = 1; c <= numco + 1; c++) postidx[c] += postidx[c-1];
+  for (e = numev; e >= 1; e--)
+    for (i = mci_ev.data[2*e-1]; i < mci_ev.data[2*e+1]; i++)
+      post[postidx[mci_pre.data[i]]++] = e;
+
+  put_plain(numco);
+  put_plain(numev);
+  if (queries)
+  {
+    in.pos = queries;
+    while ((n = get_plain(&in)))
+    {
+      put_plain(n);
+      put_plain(n = get_plain(&in));
+      put_plain(k = get_plain(&in));
+      for (; n; n--) put_plain(get_plain(&in));
+      for (; k; k--) put_plain(fin[get_plain(&in)]);
+    }
+  }
+  put_plain(0);
+
+  for (i = 1; i <= numev; i++)
+  {
+    put_plain(mci_ev.data[2*order[i]-2]);
+    put_plain(kind[order[i]] >> 2);
+  }
+
+  for (c = 1; c <= numco; c++)
+  {
+    for (i = 4*c-4; i < 4*c-1; i++) put_plain(mci_co.data[i]);
+    put_plain(fin[mci_co.data[i]]);
+    for (i = postidx[c-1]; i < postidx[c]; i++) put_plain(fin[post[i]]);
+    put_plain(0);
+  }
+
+  for (i = mci_harm.size - 1; i >= 0; i--) put_plain(fin[mci_harm.data[i]]);
+  put_plain(0);
+  for (i = mci_cut.size - 2; i >= 0; i -= 2)
+  {
+    put_plain(fin[mci_cut.data[i]]);
+    put_plain(fin[mci_cut.data[i+1]]);
+  }
+  put_plain(0);
+  if (budget)
+  {
+    in.pos = budget;
+    while ((n = get_plain(&in))) put_plain(n);
+  }
+  put_plain(0);
+
+  put_plain(numpl);
+  put_plain(numtr);
+  put_plain(maxname);
+  put_bytes(names,names_end - names);
+
+  unstream_free();
+  *plain_size = mci_out.size;
+  return (char*) mci_out.data;
+}
@@ -0,0 +1,107 @@
+/****************************************************************************/
+/* mcipack.h								    */
+/*									    */
+/* Definitions for mcipack.c: the packed .mci format (version 2) and the  */
+/* streamed one, shared by ecofolder, the .mci reader and mciconv.	    */
+/****************************************************************************/
+
+#ifndef __MCIPACK_H__
+#define __MCIPACK_H__
+
+#include <stdio.h>
+#include <setjmp.h>
+
+/* A packed file holds the same contents as a plain one. It starts with a
+   header of little-endian 32-bit words:
+
+     "\177MCI", version (2), CRC-32 of the rest of the file, flags,
+     numco, numev, numpl, numtr, maxname, number of sections,
+
+   followed by one entry per section: its id and its offset and length in
+   bytes as 64-bit words. The sections come in the order of their ids.
+   Inside them the integers are LEB128 numbers, signed ones in zigzag
+   encoding, and most event and condition numbers are stored as the
+   difference to the previous one. Names are stored as they are. */
+
+#define MCI_MAGIC "\177MCI"
+#define MCI_VERSION 2
+
+#define MCI_PACKED_COMPRESSED 1   /* flag: written by ecofolder -c */
+
+enum { MCI_SEC_QUERIES = 1, MCI_SEC_EVENTS, MCI_SEC_CONDITIONS,
+       MCI_SEC_HARMFUL, MCI_SEC_CUTOFFS, MCI_SEC_PLACES,
+       MCI_SEC_TRANSITIONS, MCI_SECTIONS = MCI_SEC_TRANSITIONS };
+
+/* A streamed file (ecofolder -stream) is written while the prefix is
+   computed. Like a plain file it holds native integers: "\177MCS", the
+   version (1), numpl, numtr, maxname and the names as at the end of a
+   plain file, then one record per step of the unfolding:
+
+     MCI_REC_CONDITION place token queried generating-event
+     MCI_REC_EVENT transition preset-size preset-conditions...
+     MCI_REC_CUTOFF event corresponding-event
+     MCI_REC_HARMFUL event
+
+   Events and conditions are numbered in the order of their records.
+   MCI_REC_END starts the trailer written at the end of the run: the
+   event the run stopped at (-T), or 0, the queried events and the
+   queried conditions, each as a count and a list, the query cuts as in
+   a plain file and the list that follows the cutoffs in a plain file
+   (the budget that cut the run short, see unfold.h). Without a trailer,
+   as left by an interrupted run, the file still holds the prefix made
+   of the recorded events. */
+
+#define MCI_STREAM_MAGIC "\177MCS"
+#define MCI_STREAM_VERSION 1
+
+enum { MCI_REC_CONDITION = 1, MCI_REC_EVENT, MCI_REC_CUTOFF,
+       MCI_REC_HARMFUL, MCI_REC_END };
+
+/* A packed file is written as the plain one is fed to the packer, in
+   pieces of any size: mci_pack_begin takes a file opened for update,
+   mci_pack_write packs whatever the pieces complete and writes the
+   sections as they grow, and mci_pack_end fills in the header. The
+   latter returns 0, or -1 with mci_pack_error set if the pieces did not
+   make a plain file or the file could not be written. */
+
+extern void mci_pack_begin (FILE*,int);
+extern void mci_pack_write (const void*,long);
+extern int mci_pack_end ();
+
+/* mci_unpack and mci_unstream return a buffer allocated with malloc, or
+   NULL with mci_pack_error set if the input is not a valid file of its
+   kind. mci_unstream gives the plain file ecofolder writes without
+   -stream. */
+
+extern const char *mci_pack_error;
+
+extern int mci_is_packed (const char*,long);
+extern char* mci_unpack (const char*,long,int*,long*);
+extern int mci_is_streamed (const char*,long);
+extern char* mci_unstream (const char*,long,long*);
+
+/* Reading a packed file in place: mci_sections checks the header and
+   the checksum and finds the sections, which are then read with the
+   functions below. Errors in the file jump to mci_pack_jmp with
+   mci_pack_error set. */
+
+typedef struct mcicur_t
+{
+  const unsigned char *pos, *end;
+} mcicur_t;
+
+typedef struct mcihead_t
+{
+  int compressed;	/* MCI_PACKED_COMPRESSED set in the flags */
+  int numco, numev, numpl, numtr, maxname;
+  mcicur_t sec[MCI_SECTIONS+1];	/* the sections by id */
+} mcihead_t;
+
+extern jmp_buf mci_pack_jmp;
+
+extern void mci_sections (const char*,long,mcihead_t*);
+extern long long mci_get_int (mcicur_t*);
+extern long mci_get_count (mcicur_t*);
+extern const char* mci_get_str (mcicur_t*);
+
+#endif
@@ -0,0 +1,440 @@
+/****************************************************************************/
+/* mciread.c								    */
+/*									    */
+/* Reading an .mci file: the file is mapped into memory and read once,     */
+/* the integers are gathered into arrays indexed by events and conditions  */
+/* and the names are left in place. The sections of a packed file	    */
+/* (mcipack.h) are decoded from where they are mapped, a streamed file is  */
+/* turned into the plain format in memory first.			    */
+/****************************************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mciread.h"
+#include "mcipack.h"
+
+static const char *mci_name;	/* file being read, for error messages */
+static char *mci_pos, *mci_end;
+
+static void mci_error (const char *msg)
+{
+  fprintf(stderr,"%s: %s\n",mci_name,msg);
+  exit(1);
+}
+
+static void* mci_alloc (long size)
+{
+  void *ptr = calloc(size ? size : 1, 1);
+  if (!ptr) mci_error("out of memory");
+  return ptr;
+}
+
+static int mci_int ()
+{
+  int i;
+  if (mci_end - mci_pos < sizeof(int)) mci_error("unexpected end of file");
+  memcpy(&i,mci_pos,sizeof(int));
+  mci_pos += sizeof(int);
+  return i;
+}
+
+/* Skip n integers, return a pointer to the first one. The integers
+   before the names are aligned, since they are all integers. */
+
+static const int* mci_ints (int n)
+{
+  const int *ptr = (const int*) mci_pos;
+  if (n < 0 || (mci_end - mci_pos) / sizeof(int) < n)
+    mci_error("unexpected end of file");
+  mci_pos += n * sizeof(int);
+  return ptr;
+}
+
+static char* mci_str ()
+{
+  char *str = mci_pos, *end = memchr(mci_pos,0,mci_end - mci_pos);
+  if (!end) mci_error("unexpected end of file");
+  mci_pos = end + 1;
+  return str;
+}
+
+static int mci_event (mci_t *mci, int e)
+{
+  if (e < 0 || e > mci->numev) mci_error("event out of range");
+  return e;
+}
+
+/* Read the names of places or transitions, ended by an empty one, or
+   from the section 'sec' of a packed file. */
+
+static char** mci_names (int num, int **ids, mcicur_t *sec)
+{
+  char **names = mci_alloc((num + 2) * sizeof(char*));
+  int i, id;
+
+  *ids = mci_alloc((num + 1) * sizeof(int));
+  for (i = 1; i <= num; i++)
+  {
+    id = sec ? mci_get_int(sec) : mci_int();
+    if (id < 1 || id > num) mci_error("identifier out of range");
+    (*ids)[i] = id;
+    names[id] = sec ? (char*) mci_get_str(sec) : mci_str();
+  }
+  if (!sec) mci_str();
+  return names;
+}
+
+/* Build the compressed rows of the events' pre- and postsets from the
+   conditions. */
+
+static void mci_events (mci_t *mci)
+{
+  int c, e, k, *pre, *post;
+
+  mci->ev_preidx = mci_alloc((mci->numev + 2) * sizeof(int));
+  mci->ev_postidx = mci_alloc((mci->numev + 2) * sizeof(int));
+  for (c = 1; c <= mci->numco; c++)
+  {
+    if (mci->co_pre[c]) mci->ev_postidx[mci->co_pre[c]+1]++;
+    for (k = mci->co_postidx[c]; k < mci->co_postidx[c+1]; k++)
+      mci->ev_preidx[mci->co_post[k]+1]++;
+  }
+  for (e = 1; e <= mci->numev + 1; e++)
+  {
+    mci->ev_preidx[e] += mci->ev_preidx[e-1];
+    mci->ev_postidx[e] += mci->ev_postidx[e-1];
+  }
+  mci->ev_pre = mci_alloc(mci->ev_preidx[mci->numev+1] * sizeof(int));
+  mci->ev_post = mci_alloc(mci->ev_postidx[mci->numev+1] * sizeof(int));
+
+  /* next free slot of each row */
+  pre = mci_alloc((mci->numev + 1) * sizeof(int));
+  post = mci_alloc((mci->numev + 1) * sizeof(int));
+  memcpy(pre,mci->ev_preidx,(mci->numev + 1) * sizeof(int));
+  memcpy(post,mci->ev_postidx,(mci->numev + 1) * sizeof(int));
+  for (c = 1; c <= mci->numco; c++)
+  {
+    if (mci->co_pre[c]) mci->ev_post[post[mci->co_pre[c]]++] = c;
+    for (k = mci->co_postidx[c]; k < mci->co_postidx[c+1]; k++)
+      mci->ev_pre[pre[mci->co_post[k]]++] = c;
+  }
+  free(pre); free(post);
+}
+
+/* Read the sections of a packed file; the integers are stored as in
+   mcipack.c. The query cuts, the harmful events and the cutoffs are
+   allocated, the names are left in the file. */
+
+static void mci_read_packed (mci_t *mci, int flags)
+{
+  mcihead_t head;
+  mcicur_t cur;
+  long n, k;
+  int c, e, v, rep, numpost, prev_pre, prev_group;
+  int *list;
+
+  if (setjmp(mci_pack_jmp)) mci_error(mci_pack_error);
+  mci_sections(mci->map,mci->size,&head);
+  /* unlike a plain file, a packed one tells whether it holds a
+     compressed prefix */
+  if (head.compressed && !(flags & MCI_COMPRESSED))
+    mci_error("compressed prefix, the tool expects a plain one");
+  if (!head.compressed && (flags & MCI_COMPRESSED))
+    mci_error("plain prefix, the tool expects a compressed one");
+  mci->numco = head.numco;
+  mci->numev = head.numev;
+  mci->numpl = head.numpl;
+  mci->numtr = head.numtr;
+  mci->maxname = head.maxname;
+
+  /* query cuts, each with its conditions and events */
+  for (cur = head.sec[MCI_SEC_QUERIES]; (rep = mci_get_int(&cur)); )
+  {
+    if (abs(rep) > mci->numcuts) mci->numcuts = abs(rep);
+    for (n = mci_get_count(&cur) + mci_get_count(&cur); n; n--)
+      mci_get_int(&cur);
+  }
+  mci->cuts = mci_alloc((mci->numcuts + 1) * sizeof(mci_cut_t*));
+  for (cur = head.sec[MCI_SEC_QUERIES]; (rep = mci_get_int(&cur)); )
+  {
+    long szcut = mci_get_count(&cur), szevscut = mci_get_count(&cur);
+    mci_cut_t *cut = mci_alloc(sizeof(mci_cut_t) +
+			       (szcut + szevscut) * sizeof(int));
+    cut->repeat = rep;
+    cut->szcut = szcut;
+    cut->szevscut = szevscut;
+    cut->cut = list = (int*) (cut + 1);
+    cut->evscut = list + szcut;
+    for (v = 0, k = 0; k < szcut + szevscut; k++)
+    {
+      if (k == szcut) v = 0;
+      list[k] = v += mci_get_int(&cur);
+    }
+    free(mci->cuts[abs(rep)]);
+    mci->cuts[abs(rep)] = cut;
+  }
+
+  mci->ev2tr = mci_alloc((mci->numev + 1) * sizeof(int));
+  mci->ev_queried = mci_alloc((mci->numev + 1) * sizeof(int));
+  cur = head.sec[MCI_SEC_EVENTS];
+  for (e = 1; e <= mci->numev; e++)
+  {
+    mci->ev2tr[e] = mci_get_int(&cur);
+    mci->ev_queried[e] = mci_get_int(&cur);
+  }
+
+  /* conditions, read twice: first count the consumers */
+  mci->co2pl = mci_alloc((mci->numco + 2) * sizeof(int));
+  mci->co_token = mci_alloc((mci->numco + 2) * sizeof(int));
+  mci->co_queried = mci_alloc((mci->numco + 2) * sizeof(int));
+  mci->co_pre = mci_alloc((mci->numco + 2) * sizeof(int));
+  mci->co_postidx = mci_alloc((mci->numco + 2) * sizeof(int));
+  if (flags & MCI_COMPRESSED)
+    mci->co_group = mci_alloc((mci->numco + 2) * sizeof(int));
+  cur = head.sec[MCI_SEC_CONDITIONS];
+  for (numpost = 0, c = 1; c <= mci->numco; c++)
+  {
+    if (flags & MCI_COMPRESSED)
+    {
+      n = mci_get_count(&cur);
+      for (k = 4 * n; k; k--) mci_get_int(&cur);
+      if (n) c += n - 1;
+    }
+    else
+      for (k = 3; k; k--) mci_get_int(&cur);
+    mci_get_int(&cur);
+    for (n = mci_get_count(&cur); n; n--, numpost++) mci_get_int(&cur);
+  }
+  mci->co_post = mci_alloc(numpost * sizeof(int));
+
+  /* in a compressed prefix the conditions of a node come as a group,
+     the last of which gets the pre- and postset */
+  cur = head.sec[MCI_SEC_CONDITIONS];
+  for (numpost = prev_pre = prev_group = 0, c = 1; c <= mci->numco; c++)
+  {
+    if (flags & MCI_COMPRESSED)
+    {
+      n = mci_get_count(&cur);
+      for (k = 0; k < n; k++, c++)
+      {
+        if (c > mci->numco) mci_error("too many conditions");
+        mci->co_postidx[c+1] = numpost;
+        mci->co2pl[c] = mci_get_int(&cur);
+        mci->co_token[c] = mci_get_int(&cur);
+        mci->co_queried[c] = mci_get_int(&cur);
+        mci->co_group[c] = prev_group += mci_get_int(&cur);
+      }
+      if (n) c--;
+    }
+    else
+    {
+      mci->co2pl[c] = mci_get_int(&cur);
+      mci->co_token[c] = mci_get_int(&cur);
+      mci->co_queried[c] = mci_get_int(&cur);
+    }
+    mci->co_pre[c] = mci_event(mci,v = prev_pre += mci_get_int(&cur));
+    for (n = mci_get_count(&cur); n; n--)
+      mci->co_post[numpost++] = mci_event(mci,v += mci_get_int(&cur));
+    mci->co_postidx[c+1] = numpost;
+  }
+  mci_events(mci);
+
+  cur = head.sec[MCI_SEC_HARMFUL];
+  mci->numharmful = mci_get_count(&cur);
+  mci->harmful = list = mci_alloc(mci->numharmful * sizeof(int));
+  for (v = 0, k = 0; k < mci->numharmful; k++)
+    list[k] = v += mci_get_int(&cur);
+
+  /* the list after the cutoffs is not kept, as for a plain file */
+  cur = head.sec[MCI_SEC_CUTOFFS];
+  mci->numcutoffs = mci_get_count(&cur);
+  mci->cutoffs = list = mci_alloc(2 * mci->numcutoffs * sizeof(int));
+  for (v = 0, k = 0; k < 2 * mci->numcutoffs; k += 2)
+  {
+    list[k] = v += mci_get_int(&cur);
+    list[k+1] = mci_get_int(&cur);
+  }
+
+  mci->plname = mci_names(mci->numpl,&mci->plids,&head.sec[MCI_SEC_PLACES]);
+  mci->trname = mci_names(mci->numtr,&mci->trids,
+			  &head.sec[MCI_SEC_TRANSITIONS]);
+}
+
+mci_t* mci_read (const char *filename, int flags)
+{
+  mci_t *mci;
+  struct stat st;
+  int fd, i, c, e, k, rep, numpost;
+  char *conds, *plain;
+
+  mci_name = filename;
+  if ((fd = open(filename,O_RDONLY)) < 0 || fstat(fd,&st) || !st.st_size)
+  {
+    fprintf(stderr,"cannot read file %s\n",filename);
+    exit(1);
+  }
+  mci = mci_alloc(sizeof(mci_t));
+  mci->size = st.st_size;
+  mci->map = mmap(NULL,mci->size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if (mci->map == MAP_FAILED)
+  {
+    fprintf(stderr,"cannot read file %s\n",filename);
+    exit(1);
+  }
+  if (mci_is_packed(mci->map,mci->size))
+  {
+    mci->packed = MCI_PACKED;
+    mci_read_packed(mci,flags);
+    return mci;
+  }
+  else if (mci_is_streamed(mci->map,mci->size))
+  {
+    plain = mci_unstream(mci->map,mci->size,&mci->size);
+    if (!plain) mci_error(mci_pack_error);
+    munmap(mci->map,st.st_size);
+    mci->map = plain;
+    mci->packed = MCI_STREAMED;
+    /* ecofolder -stream does not write compressed prefixes */
+    if (flags & MCI_COMPRESSED)
+      mci_error("plain prefix, the tool expects a compressed one");
+  }
+  mci_pos = mci->map;
+  mci_end = mci->map + mci->size;
+
+  mci->numco = mci_int();
+  mci->numev = mci_int();
+  if (mci->numco < 0 || mci->numev < 0) mci_error("not an mci file");
+
+  /* query cuts: the first one has the highest instance */
+  conds = mci_pos;
+  while ((rep = mci_int()))
+  {
+    if (abs(rep) > mci->numcuts) mci->numcuts = abs(rep);
+    i = mci_int(); k = mci_int();
+    mci_ints(i); mci_ints(k);
+  }
+  mci->cuts = mci_alloc((mci->numcuts + 1) * sizeof(mci_cut_t*));
+  mci_pos = conds;
+  while ((rep = mci_int()))
+  {
+    mci_cut_t *cut = mci_alloc(sizeof(mci_cut_t));
+    cut->repeat = rep;
+    cut->szcut = mci_int();
+    cut->szevscut = mci_int();
+    cut->cut = mci_ints(cut->szcut);
+    cut->evscut = mci_ints(cut->szevscut);
+    free(mci->cuts[abs(rep)]);
+    mci->cuts[abs(rep)] = cut;
+  }
+
+  mci->ev2tr = mci_alloc((mci->numev + 1) * sizeof(int));
+  mci->ev_queried = mci_alloc((mci->numev + 1) * sizeof(int));
+  for (e = 1; e <= mci->numev; e++)
+  {
+    mci->ev2tr[e] = mci_int();
+    mci->ev_queried[e] = mci_int();
+  }
+
+  /* conditions, read twice: first count the consumers */
+  mci->co2pl = mci_alloc((mci->numco + 2) * sizeof(int));
+  mci->co_token = mci_alloc((mci->numco + 2) * sizeof(int));
+  mci->co_queried = mci_alloc((mci->numco + 2) * sizeof(int));
+  mci->co_pre = mci_alloc((mci->numco + 2) * sizeof(int));
+  mci->co_postidx = mci_alloc((mci->numco + 2) * sizeof(int));
+  if (flags & MCI_COMPRESSED)
+    mci->co_group = mci_alloc((mci->numco + 2) * sizeof(int));
+  conds = mci_pos;
+  for (numpost = 0, c = 1; c <= mci->numco; c++)
+  {
+    if (flags & MCI_COMPRESSED)
+    {
+      /* place, token, queried, group, next place or 0 */
+      for (k = mci_int(); k; )
+      {
+        mci_ints(3);
+        if ((k = mci_int())) c++;
+      }
+    }
+    else
+      mci_ints(3);
+    mci_int();
+    while (mci_int()) numpost++;
+  }
+  mci->co_post = mci_alloc(numpost * sizeof(int));
+
+  mci_pos = conds;
+  for (numpost = 0, c = 1; c <= mci->numco; c++)
+  {
+    if (flags & MCI_COMPRESSED)
+    {
+      for (k = mci_int(); ; c++)
+      {
+        if (c > mci->numco) mci_error("too many conditions");
+        mci->co_postidx[c+1] = numpost;
+        mci->co2pl[c] = k;
+        if (!k) break;
+        mci->co_token[c] = mci_int();
+        mci->co_queried[c] = mci_int();
+        mci->co_group[c] = mci_int();
+        if (!(k = mci_int())) break;
+      }
+    }
+    else
+    {
+      mci->co2pl[c] = mci_int();
+      mci->co_token[c] = mci_int();
+      mci->co_queried[c] = mci_int();
+    }
+    mci->co_pre[c] = mci_event(mci,mci_int());
+    while ((e = mci_int()))
+      mci->co_post[numpost++] = mci_event(mci,e);
+    mci->co_postidx[c+1] = numpost;
+  }
+  mci_events(mci);
+
+  for (conds = mci_pos; mci_int(); mci->numharmful++);
+  mci->harmful = (const int*) conds;
+  for (conds = mci_pos; mci_int(); mci->numcutoffs++) mci_int();
+  mci->cutoffs = (const int*) conds;
+
+  while (mci_int());
+  mci->numpl = mci_int();
+  mci->numtr = mci_int();
+  mci->maxname = mci_int();
+  if (mci->numpl < 0 || mci->numtr < 0) mci_error("not an mci file");
+  mci->plname = mci_names(mci->numpl,&mci->plids,NULL);
+  mci->trname = mci_names(mci->numtr,&mci->trids,NULL);
+  return mci;
+}
+
+void mci_free (mci_t *mci)
+{
+  int i;
+
+  for (i = 0; i <= mci->numcuts; i++) free(mci->cuts[i]);
+  free(mci->cuts);
+  free(mci->ev2tr); free(mci->ev_queried);
+  free(mci->co2pl); free(mci->co_token); free(mci->co_queried);
+  free(mci->co_group); free(mci->co_pre);
+  free(mci->co_postidx); free(mci->co_post);
+  free(mci->ev_preidx); free(mci->ev_pre);
+  free(mci->ev_postidx); free(mci->ev_post);
+  free(mci->plname); free(mci->trname);
+  free(mci->plids); free(mci->trids);
+  if (mci->packed == MCI_PACKED)
+  {
+    free((int*) mci->harmful);
+    free((int*) mci->cutoffs);
+  }
+  if (mci->packed == MCI_STREAMED) free(mci->map);
+  else munmap(mci->map,mci->size);
+  free(mci);
+}
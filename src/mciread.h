@@ -0,0 +1,81 @@
+/****************************************************************************/
+/* mciread.h								    */
+/*									    */
+/* Definitions for mciread.c: reading an .mci file into memory, shared by  */
+/* the mci2* tools and sateval.						    */
+/****************************************************************************/
+
+#ifndef __MCIREAD_H__
+#define __MCIREAD_H__
+
+/* A query cut, as written by ecofolder for a queried marking: its
+   conditions and events. The arrays point into the file, or follow the
+   cut for a packed file, and are indexed from 0. */
+
+typedef struct mci_cut_t
+{
+  int repeat;          /* instance of the marking, negative if it is
+                          not the one asked for with ecofolder -r   */
+  int szcut, szevscut;
+  const int *cut;      /* conditions of the cut                     */
+  const int *evscut;   /* events leading to it                      */
+} mci_cut_t;
+
+/* The contents of an .mci file. Events are numbered 1..numev and
+   conditions 1..numco, the arrays below are indexed by these numbers.
+   The consumers of a condition and the pre- and postsets of an event
+   are kept in compressed rows: the consumers of c are
+   co_post[co_postidx[c]] .. co_post[co_postidx[c+1]-1], in the order of
+   the file, and likewise for ev_pre and ev_post, which are sorted. The
+   lists of harmful events and of cutoffs point into the file. */
+
+typedef struct mci_t
+{
+  int numco, numev;
+  int numpl, numtr, maxname;
+
+  int numcuts;         /* cuts[1..numcuts], NULL if not in the file   */
+  mci_cut_t **cuts;
+
+  int *ev2tr;          /* transition of each event                  */
+  int *ev_queried;     /* query flag of each event                  */
+  int *co2pl;          /* place of each condition                   */
+  int *co_token;       /* whether the condition carries a token     */
+  int *co_queried;     /* query flag of each condition              */
+  int *co_group;       /* compressed prefixes: group of the condition */
+  int *co_pre;         /* generating event, 0 for the initial cut    */
+  int *co_postidx, *co_post;   /* consumers of each condition       */
+  int *ev_preidx, *ev_pre;     /* conditions consumed by each event */
+  int *ev_postidx, *ev_post;   /* conditions produced by each event */
+
+  int numharmful;      /* harmful events                            */
+  const int *harmful;
+  int numcutoffs;      /* pairs (cutoff, corresponding event or 0)  */
+  const int *cutoffs;
+
+  char **plname;       /* names by id, pointing into the file        */
+  char **trname;
+  int *plids, *trids;  /* ids of the places/transitions in file order */
+
+  char *map;           /* the file, mapped into memory              */
+  long size;
+  int packed;          /* MCI_PACKED or MCI_STREAMED, else 0        */
+} mci_t;
+
+/* The cuts, the harmful events and the cutoffs of a packed file are
+   decoded into arrays of their own; a streamed file is turned into the
+   plain format, which map then holds. */
+
+#define MCI_PACKED 1
+#define MCI_STREAMED 2
+
+/* In a compressed prefix (ecofolder -c), the conditions merged into one
+   node are stored one after the other with the same group number, and
+   only the last one of them carries the pre- and postset of the node. */
+
+#define MCI_COMPRESSED 1
+
+extern mci_t* mci_read (const char*,int);
+extern void mci_free (mci_t*);
+
+#endif
@@ -32,6 +32,7 @@ unf_t* nc_create_unfolding()
   unf->conditions = NULL;
   unf->events = NULL;
   unf->numco = unf->numev = 0;
+  unf->arena = arena_create();
   return unf;
 }
 
@@ -96,15 +97,85 @@ void nc_create_arc (nodelist_t **fromlist, nodelist_t **tolist,
   nodelist_push(tolist,from);
 }
 
+/****************************************************************************/
+/* nc_fill_arcs							    */
+/* Copy list1 into arr, followed by the nodes of list2 that are not in	    */
+/* list1, i.e. the same sequence as nodelist_concatenate(list1,list2).	    */
+/* Returns the number of entries.					    */
+
+int nc_fill_arcs (void **arr, nodelist_t *list1, nodelist_t *list2)
+{
+  int k = 0, n1, i;
+
+  for (; list1; list1 = list1->next) arr[k++] = list1->node;
+  for (n1 = k; list2; list2 = list2->next)
+  {
+    for (i = 0; i < n1 && arr[i] != list2->node; i++);
+    if (i == n1) arr[k++] = list2->node;
+  }
+  return k;
+}
+
+/****************************************************************************/
+/* nc_compute_roles, nc_arc_role					    */
+/* Every transition keeps a small open-addressing hash table of the places  */
+/* around it, filled at most to one half, so that nc_arc_role tells in	    */
+/* constant time whether a place is in its preset, postset or reset.	    */
+
+#define ROLE_SLOT(pl,mask) (((unsigned)(pl)->num * 0x9e3779b1u) & (mask))
+
+void nc_add_role (trans_t *tr, nodelist_t *list, uchar role)
+{
+  int slot;
+
+  for (; list; list = list->next)
+  {
+    slot = ROLE_SLOT((place_t*)list->node,tr->roles_mask);
+    while (tr->roles[slot].pl && tr->roles[slot].pl != list->node)
+      slot = (slot+1) & tr->roles_mask;
+    tr->roles[slot].pl = list->node;
+    tr->roles[slot].role |= role;
+  }
+}
+
+void nc_compute_roles (net_t *net)
+{
+  trans_t *tr;
+  int size;
+
+  for (tr = net->transitions; tr; tr = tr->next)
+  {
+    for (size = 2; size < 2*(tr->prereset_size + tr->postset_size); size *= 2);
+    tr->roles = MYcalloc(size * sizeof(arcrole_t));
+    tr->roles_mask = size-1;
+    nc_add_role(tr,tr->preset,ARC_PRE);
+    nc_add_role(tr,tr->postset,ARC_POST);
+    nc_add_role(tr,tr->reset,ARC_RESET);
+  }
+}
+
+uchar nc_arc_role (trans_t *tr, place_t *pl)
+{
+  int slot = ROLE_SLOT(pl,tr->roles_mask);
+
+  while (tr->roles[slot].pl && tr->roles[slot].pl != pl)
+    slot = (slot+1) & tr->roles_mask;
+  return tr->roles[slot].role;
+}
+
 /****************************************************************************/
 /* nc_compute_sizes							    */
-/* compute (maximal) sizes of transition presets/postsets/resets		    */
+/* compute (maximal) sizes of transition presets/postsets/resets, and fill  */
+/* the arrays of adjacent nodes used by the unfolder. The arrays of all     */
+/* transitions (resp. places) share one contiguous block.		    */
 
 void nc_compute_sizes (net_t *net)
 {
   trans_t *tr;
   place_t *pl;
-  int k, sz = 0;
+  place_t **tr_arcs;
+  trans_t **pl_arcs;
+  int k, sz = 0, total;
 
   net->maxpre = net->maxpost = net->maxres = net->maxctx = 0;
   for (tr = net->transitions; tr; tr = tr->next)
@@ -128,13 +199,41 @@ void nc_compute_sizes (net_t *net)
     for (k = 0, list = tr->ctxset; list; k++, list = list->next);
     tr->ctxset_size = k;
     if (net->maxctx < k) net->maxctx = k;
+  }
 
-    for (k = 0, list = nodelist_concatenate(tr->preset, tr->reset); list; k++, list = list->next);
-    tr->prereset_size = k;
+  for (total = 0, tr = net->transitions; tr; tr = tr->next)
+    total += tr->preset_size + tr->postset_size + 3*tr->reset_size;
+  tr_arcs = MYmalloc((total+1) * sizeof(place_t*));
+  for (tr = net->transitions; tr; tr = tr->next)
+  {
+    tr->prereset_arr = tr_arcs;
+    tr_arcs += tr->prereset_size = nc_fill_arcs((void**)tr_arcs,
+        tr->preset, tr->reset);
+    tr->postreset_arr = tr_arcs;
+    tr_arcs += tr->postreset_size = nc_fill_arcs((void**)tr_arcs,
+        tr->postset, tr->reset);
+    tr->reset_arr = tr_arcs;
+    tr_arcs += nc_fill_arcs((void**)tr_arcs, tr->reset, NULL);
+  }
 
-    for (k = 0, list = nodelist_concatenate(tr->postset, tr->reset); list; k++, list = list->next);
-    tr->postreset_size = k;
+  for (total = 0, pl = net->places; pl; pl = pl->next)
+  {
+    nodelist_t *list;
+    for (k = 0, list = pl->postset; list; k++, list = list->next);
+    pl->postset_size = k;
+    for (list = pl->reset; list; k++, list = list->next);
+    total += k;
   }
+  pl_arcs = MYmalloc((total+1) * sizeof(trans_t*));
+  for (pl = net->places; pl; pl = pl->next)
+  {
+    pl->postreset_arr = pl_arcs;
+    pl_arcs += pl->postreset_size = nc_fill_arcs((void**)pl_arcs,
+        pl->postset, pl->reset);
+  }
+
+  nc_compute_roles(net);
+
   net->maxtrname = sz;
   sz = 0;
   for (pl = net->places; pl; pl = pl->next)
@@ -28,6 +28,9 @@ typedef struct place_t
   struct nodelist_t *reset;  /* unordered list of reset transitions */
   struct nodelist_t *conds;  /* conditions derived from this place   */
   struct nodelist_t *ctxset;  /* unordered list of context transitions */
+  struct trans_t **postreset_arr; /* postset followed by the reset
+                    transitions not in the postset */
+  int postset_size, postreset_size;
   char marked;  /* non-zero if place is marked      */
   int queried;  /* non-zero if a place is queried */
   int harmful;  /* non-zero if a place is harmful  */
@@ -43,11 +46,31 @@ typedef struct trans_t
   struct nodelist_t *postset; /* unordered list of postset      */
   struct nodelist_t *reset; /* unordered list of reset */
   struct nodelist_t *ctxset; /* unordered list of context transitions */
+  struct place_t **prereset_arr;  /* preset followed by the reset places
+                    not in the preset; its first preset_size entries
+                    are the preset */
+  struct place_t **postreset_arr; /* same for the postset */
+  struct place_t **reset_arr;     /* reset places */
+  struct arcrole_t *roles;  /* hash table of adjacent places, see nc_arc_role */
+  int roles_mask;
   short  preset_size, postset_size, reset_size, 
     prereset_size, postreset_size, ctxset_size;
   char blocked;
 } trans_t;
 
+/* Roles of a place with respect to a transition, as returned by nc_arc_role.
+   A place can have several roles (e.g. be in the preset and the reset). */
+
+#define ARC_PRE   1
+#define ARC_POST  2
+#define ARC_RESET 4
+
+typedef struct arcrole_t
+{
+  struct place_t *pl;
+  uchar role;  /* ARC_* flags */
+} arcrole_t;
+
 typedef struct restr_t
 {
   struct restr_t *next;
@@ -87,6 +110,10 @@ typedef struct event_t
   coa_t  coarray;
   int    id;
   int queried;        /* non-zero if the event has a causal relation with a queried marking      */
+  int    num;        /* number, in order of insertion */
+  struct cobits_t *history;  /* causal past of e (-mcmillan only) */
+  int    lc_size;      /* size of the local configuration [e] */
+  struct parikh_t *p_vector;  /* Parikh vector of [e] */
   short  foata_level;
   short  preset_size, postset_size;
 } event_t;
@@ -114,14 +141,24 @@ typedef struct
   int numco, numev;  /* number of conditions/events in net  */
   struct nodelist_t *m0;  /* list of minimal conditions    */
   struct nodelist_t *m0_unmarked;  /* list of minimal unmarked conditions    */
+  struct arena_t *arena;  /* memory of conditions, events and co-arrays */
 } unf_t;
 
+/* A marking is a fixed-width bit vector over the places of the net, bit
+   pl->num-1 being set iff pl is marked. The hash is computed once when the
+   marking is complete, so that lookups only compare it and the words. */
+
+typedef struct marking_t
+{
+  unsigned long long hash;  /* 64-bit hash of the bit vector   */
+  unsigned long long bits[];  /* marking_words words of place bits */
+} marking_t;
+
 typedef struct hashcell_t
 {
-  struct nodelist_t *marking;
+  struct marking_t *marking;
   struct nodelist_t *pre_evs;
   int repeat;
-  struct hashcell_t *next;
 } hashcell_t;
 
 typedef struct querycell_t
@@ -143,6 +180,7 @@ extern trans_t* nc_create_transition (net_t*,int);
 extern restr_t* nc_create_restriction(net_t*);
 extern void nc_create_arc (struct nodelist_t**,struct nodelist_t**,void*,void*);
 extern void nc_compute_sizes (net_t*);
+extern uchar nc_arc_role (trans_t*,place_t*);
 extern void nc_static_checks (net_t*,char*);
 extern void nc_create_trans_pool (net_t*);
 extern void nc_create_ignored_trans (net_t*);
@@ -177,8 +215,20 @@ extern char* pr_encoding(char*);
 /****************************************************************************/
 /* declarations for mci.c and mci_cpr.c                */
 
+extern int mciv2;   /* whether the -mciv2 switch has been supplied */
+extern int mcistream;  /* whether the -stream switch has been supplied */
+
 extern void write_mci_file (char*);
 extern void write_mci_file_cpr (char*);
 extern void* reverse_list (void *);
+extern FILE* mci_create (char*);
+extern void mci_write (FILE*,const void*,int);
+extern void mci_close (FILE*,char*);
+extern void mci_stream_open (char*);
+extern void mci_stream_condition (cond_t*);
+extern void mci_stream_event (event_t*);
+extern void mci_stream_cutoff (event_t*,event_t*);
+extern void mci_stream_harmful (event_t*);
+extern void mci_stream_close (event_t*);
 
 #endif
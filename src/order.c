@@ -13,6 +13,14 @@ parikh_t *pa_last;
 int parikh_count; /* counts the total number of elements in the vector */
 int parikh_size;  /* counts the number of different transitions        */
 
+int queue_count;    /* number of queue entries created, for their ids */
+
+int foata_compares; /* number of calls to foata_compare */
+double foata_time;  /* time spent in foata_compare, for -stats */
+long create_queue_calls;    /* calls to create_queue_entry and their */
+double create_queue_time;   /* time, for -stats */
+int foata_cached;   /* normal forms found in the cache by foata_compare */
+
 /*****************************************************************************/
 
 void parikh_init ()
@@ -90,6 +98,43 @@ void parikh_add (int tr_num)
   parikh_add: pa_last->appearances++;
 }
 
+/*****************************************************************************/
+/* Add all appearances recorded in the (saved) vector pv, merging the two    */
+/* sorted vectors from the back so that no entry needs to be moved twice.    */
+
+void parikh_merge (parikh_t *pv, int count)
+{
+  parikh_t *p, *q, *dst;
+  int size = parikh_size;
+
+  /* count the entries of the merged vector */
+  for (p = parikh + 1, q = pv; q->tr_num; q++)
+  {
+    while (p <= parikh + parikh_size && p->tr_num < q->tr_num) p++;
+    if (p > parikh + parikh_size || p->tr_num != q->tr_num) size++;
+  }
+
+  p = parikh + parikh_size;
+  dst = parikh + size;
+  while (q-- > pv)
+  {
+    while (p > parikh && p->tr_num > q->tr_num) *dst-- = *p--;
+    if (p > parikh && p->tr_num == q->tr_num)
+    {
+      dst->tr_num = q->tr_num;
+      dst->appearances = p->appearances + q->appearances;
+      p--;
+    }
+    else
+      *dst = *q;
+    dst--;
+  }
+
+  parikh_size = size;
+  parikh_count += count;
+  pa_last = parikh + 1;
+}
+
 /*****************************************************************************/
 /* Finish vector and return a copy.              */
 
@@ -118,11 +163,51 @@ int parikh_compare (parikh_t *pv1, parikh_t *pv2)
     return pv1->tr_num - pv2->tr_num;
 }
 
+/*****************************************************************************/
+/* A max-heap of events ordered by id, kept in the events array (1-based).  */
+/* Since an event is only created once its predecessors exist, the ids     */
+/* decrease along causality.                 */
+
+int ev_heap_size;
+
+void ev_heap_push (event_t *ev)
+{
+  int i = ++ev_heap_size;
+
+  while (i > 1 && events[i/2]->id < ev->id)
+  {
+    events[i] = events[i/2];
+    i /= 2;
+  }
+  events[i] = ev;
+}
+
+event_t* ev_heap_pop ()
+{
+  event_t *top = events[1], *last = events[ev_heap_size--];
+  int i = 1, c;
+
+  while ((c = 2*i) <= ev_heap_size)
+  {
+    if (c < ev_heap_size && events[c+1]->id > events[c]->id) c++;
+    if (last->id >= events[c]->id) break;
+    events[i] = events[c];
+    i = c;
+  }
+  events[i] = last;
+  return top;
+}
+
 /*****************************************************************************/
 /* Computes ordering information for the possible extension e=(tr,pe_conds)  */
 /* and returns a queue entry with that information. The ordering information */
 /* consists of the size and Parikh vector of [e]; the Foata normal form is   */
 /* computed only when necessary.               */
+/* The size and Parikh vector are obtained from those stored in the          */
+/* predecessor events: the histories of the predecessors are unwound from    */
+/* the most recent event backwards until a single event remains, whose      */
+/* summary then covers everything that is left without counting shared      */
+/* events twice.                */
 
 pe_queue_t* create_queue_entry (trans_t *tr)
 {
@@ -130,41 +215,41 @@ pe_queue_t* create_queue_entry (trans_t *tr)
   event_t *ev, **queue;
   cond_t  *co, **co_ptr;
   nodelist_t *list = NULL;  
-  int sz;
-  static int queuecount = 0;
+  int sz, i, n;
+  double start = stats? wall_time() : 0;
   
   ev_mark++;
-  *(queue = events) = NULL;
+  ev_heap_size = 0;
   parikh_reset();
   parikh_add(tr->num);
-  /* add the input events of the pre-conditions into the queue */
+  /* add the input events of the pre-conditions into the heap */
   for (sz = tr->prereset_size, co_ptr = pe_conds; sz--; )
-  {
-    (co = *co_ptr++)->mark = ev_mark;
-    if ((ev = co->pre_ev) && ev->mark != ev_mark)
-      (*++queue = ev)->mark = ev_mark;
-  }
-  
+    if ((ev = (*co_ptr++)->pre_ev) && ev->mark != ev_mark)
+    {
+      ev->mark = ev_mark;
+      ev_heap_push(ev);
+    }
 
-  while ((ev = *queue))
+  while (ev_heap_size > 1)
   {
-    queue--;
+    ev = ev_heap_pop();
     parikh_add(ev->origin->num);
 
-    /* add the immediate predecessor events of ev to the queue */
+    /* add the immediate predecessor events of ev to the heap */
     for (sz = ev->origin->prereset_size, co_ptr = ev->preset; sz--; )
-    {
-      (co = *co_ptr++)->mark = ev_mark;
-      if ((ev = co->pre_ev) && ev->mark != ev_mark)
-        (*++queue = ev)->mark = ev_mark;
-    }
+      if ((ev = (*co_ptr++)->pre_ev) && ev->mark != ev_mark)
+      {
+        ev->mark = ev_mark;
+        ev_heap_push(ev);
+      }
   }
+  if (ev_heap_size) parikh_merge(events[1]->p_vector,events[1]->lc_size);
 
   /* create the queue element */
         qu_new = MYmalloc(sizeof(pe_queue_t));
         qu_new->trans = tr;
 
-  qu_new->id = ++queuecount;
+  qu_new->id = ++queue_count;
   if (interactive)
   {
     printf("Discovered new extension E%d (%s) [condition%s",
@@ -180,49 +265,58 @@ pe_queue_t* create_queue_entry (trans_t *tr)
         qu_new->conds = MYmalloc((tr->prereset_size) * sizeof(cond_t*));
         memcpy(qu_new->conds,pe_conds,(tr->prereset_size)*sizeof(cond_t*));
 
-  /* copy Parikh vector */
-  qu_new->p_vector = parikh_save();
+  /* copy Parikh vector; it is kept by the event once e is inserted */
+  parikh[++parikh_size].tr_num = 0; /* mark the last array element */
+  qu_new->p_vector = arena_alloc(unf->arena,parikh_size * sizeof(parikh_t));
+  memcpy(qu_new->p_vector, parikh+1, parikh_size * sizeof(parikh_t));
   qu_new->lc_size = parikh_count;
+  qu_new->foata = NULL;
+  qu_new->consumed = NULL;
 
-  /* now compute the marking */
+  /* now compute the marking: collect [e], checking off the consumed
+     conditions, then take the postset conditions that remain */
   ev_mark++;
-  *(queue = events) = NULL;
-  qu_new->marking = NULL;
+  queue = events;
+  qu_new->marking = marking_alloc();
 
   for (sz = tr->prereset_size, co_ptr = pe_conds; sz--; )
-    if ((ev = (*co_ptr++)->pre_ev) && ev->mark != ev_mark)
-      (*++queue = ev)->mark = ev_mark;
+  {
+    (co = *co_ptr++)->mark = ev_mark;
+    if ((ev = co->pre_ev) && ev->mark != ev_mark)
+      (*queue++ = ev)->mark = ev_mark;
+  }
 
-  while ((ev = *queue))
+  for (n = 0; events + n < queue; n++)
+    for (sz = events[n]->origin->prereset_size,
+         co_ptr = events[n]->preset; sz--; )
+    {
+      (co = *co_ptr++)->mark = ev_mark;
+      if ((ev = co->pre_ev) && ev->mark != ev_mark)
+        (*queue++ = ev)->mark = ev_mark;
+    }
+
+  for (i = 0; i < n; i++)
   {
-    queue--;
-    
-    /* check off the postset conditions */
-    for (sz = ev->origin->postreset_size,
-       co_ptr = ev->postset; sz--;){
-    
+    ev = events[i];
+    for (sz = ev->origin->postreset_size, co_ptr = ev->postset; sz--; )
+    {
       co = *co_ptr++;
-      
-      if (co->mark != ev_mark-1 && co->token && ev &&
-        nodelist_find(ev->origin->postset, co->origin)){
-        nodelist_insert(&(qu_new->marking),co->origin);
-      }
+      if (co->mark != ev_mark && co->token &&
+        (nc_arc_role(ev->origin, co->origin) & ARC_POST))
+        marking_set(qu_new->marking,co->origin);
     }
-    /* add the immediate predecessor events of ev to the queue */
-    for (sz = ev->origin->prereset_size, co_ptr = ev->preset; sz--; )
-      if ((ev = (*co_ptr++)->pre_ev) && ev->mark != ev_mark)
-        (*++queue = ev)->mark = ev_mark;
   }
   
   /* add the post-places of tr */
-  for (list = tr->postset; list; list = list->next)
-    nodelist_insert(&(qu_new->marking), list->node);
+  for (sz = 0; sz < tr->postset_size; sz++)
+    marking_set(qu_new->marking, tr->postreset_arr[sz]);
   
   /* add the places of unconsumed minimal conditions */
   for (list = unf->m0; list; list = list->next){
-    if ((co = list->node)->mark != ev_mark-1)
-      nodelist_insert(&(qu_new->marking), co->origin);
+    if ((co = list->node)->mark != ev_mark)
+      marking_set(qu_new->marking, co->origin);
   }
+  marking_hash(qu_new->marking);
 
   if (interactive)
   {
@@ -233,6 +327,11 @@ pe_queue_t* create_queue_entry (trans_t *tr)
   
 
   
+  if (stats)
+  {
+    create_queue_calls++;
+    create_queue_time += wall_time() - start;
+  }
   return qu_new;
 }
 
@@ -289,45 +388,79 @@ nodelist_t** create_foata_lists (pe_queue_t *pe)
 }
       
 /*****************************************************************************/
-/* Compare the Foata normal form of two local configurations.        */
+/* Compute the Foata normal form of pe as one Parikh vector per slice.      */
 
-int foata_compare (pe_queue_t *pe1, pe_queue_t *pe2)
+foata_t* create_foata (pe_queue_t *pe)
 {
-  /* create the Foata "slices" for both configurations */
-  nodelist_t **fo1 = create_foata_lists(pe1);
-  nodelist_t **fo2 = create_foata_lists(pe2);
-  nodelist_t **f1 = fo1+1, **f2 = fo2+1, *list;
-  parikh_t *pv1;
-  int res = 0, pc1;
-
-  while (*f1 && *f2)  /* compare Parikh vectors, level by level */
-  {
-    parikh_reset();
-    for (list = *f1; list; list = list->next)
-      parikh_add(((trans_t*)(list->node))->num);
-    pc1 = parikh_count; pv1 = parikh_save();
+  nodelist_t **fo = create_foata_lists(pe), **f, *list;
+  foata_t *foata = MYmalloc(sizeof(foata_t));
+  int total = 0;
 
+  for (f = fo+1; *f; f++) total += nodelist_size(*f) + 1;
+  foata->levels = f - (fo+1);
+  foata->sizes = MYmalloc(foata->levels * sizeof(int));
+  foata->slices = MYmalloc(total * sizeof(parikh_t));
+
+  for (total = 0, f = fo+1; *f; f++)
+  {
     parikh_reset();
-    for (list = *f2; list; list = list->next)
+    for (list = *f; list; list = list->next)
       parikh_add(((trans_t*)(list->node))->num);
     parikh[++parikh_size].tr_num = 0;
+    foata->sizes[f-(fo+1)] = parikh_count;
+    memcpy(foata->slices + total, parikh+1, parikh_size * sizeof(parikh_t));
+    total += parikh_size;
+    nodelist_delete(*f);
+  }
+  free(fo);
+
+  return foata;
+}
 
-    res = pc1 - parikh_count;
-    if (!res) res = parikh_compare(pv1,parikh+1);
-    free(pv1);
+void foata_free (foata_t *foata)
+{
+  free(foata->sizes);
+  free(foata->slices);
+  free(foata);
+}
+
+/*****************************************************************************/
+/* Compare the Foata normal form of two local configurations. The normal    */
+/* forms are kept with the queue entries, so that the repeated comparisons  */
+/* made while sifting the queue compute each of them only once.       */
+
+int foata_compare (pe_queue_t *pe1, pe_queue_t *pe2)
+{
+  parikh_t *pv1, *pv2;
+  int res = 0, level;
+  double start = stats? wall_time() : 0;
+
+  foata_compares++;
+  if (pe1->foata) foata_cached++; else pe1->foata = create_foata(pe1);
+  if (pe2->foata) foata_cached++; else pe2->foata = create_foata(pe2);
+
+  pv1 = pe1->foata->slices, pv2 = pe2->foata->slices;
+  for (level = 0; level < pe1->foata->levels
+        && level < pe2->foata->levels; level++)
+  {  /* compare Parikh vectors, level by level */
+    res = pe1->foata->sizes[level] - pe2->foata->sizes[level];
+    if (!res) res = parikh_compare(pv1,pv2);
     if (res) break;
 
-    f1++, f2++;
+    while ((pv1++)->tr_num);
+    while ((pv2++)->tr_num);
   }
 
-  for (f1 = fo1+1; *f1; f1++) nodelist_delete(*f1);
-  for (f2 = fo2+1; *f2; f2++) nodelist_delete(*f2);
-  free(fo1);
-  free(fo2);
-
+  if (stats) foata_time += wall_time() - start;
   return res; /* should never return 0 */
 }
 
+void foata_stats ()
+{
+  printf("Foata comparisons: %d, %d of %d normal forms taken from the cache\n",
+    foata_compares, foata_cached, 2*foata_compares);
+}
+
 /*****************************************************************************/
 /* Compares two possible extensions according to the <_E order from [ERV02]. */
 /* Returns -1 if pe1 < pe2, and 1 if pe1 > pe2, 0 otherwise (can't happen?). */
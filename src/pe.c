@@ -1,6 +1,8 @@
+#include <pthread.h>
+#include <string.h>
+
 #include "common.h"
 #include "unfold.h"
-#include <string.h>
 
 /*****************************************************************************/
 
@@ -12,24 +14,93 @@
 pe_queue_t **pe_queue;    /* the priority array */
 int pe_qsize, pe_qalloc;  /* current/maximum capacity */
 
-/* This structure (a list of node lists) is used during the search for
-   possible extensions to enumerate all potential sets conditions for a
-   given transition.              */
+/* This structure is used during the search for possible extensions to
+   enumerate all potential sets of conditions for a given transition:
+   one entry per input place, each holding the candidate conditions for
+   that place (in the scratch buffer 'cands') and the current choice. */
 typedef struct pe_comb_t
 {
-  nodelist_t *current;
-  nodelist_t *start;
+  int start, size;  /* candidates of the place (size 0 ends the comb) */
+  int current;      /* the chosen one, counting down from the last */
+  int top;          /* where the lists narrowed by this choice begin */
 } pe_comb_t;
 
-pe_comb_t *pe_combs;  /* used in pe() */
+/* The possible extensions found for one condition when the search runs
+   in several threads; they are put into the queue afterwards, in the
+   order in which the serial search would have found them. */
+typedef struct pe_found_t
+{
+  int count, alloc;
+  trans_t **trans;
+  int used, conds_alloc;
+  cond_t **conds;  /* the input conditions of the extensions, in a row */
+} pe_found_t;
+
+/* Everything the search for one condition writes to, so that several
+   searches can run at the same time. */
+typedef struct pe_scratch_t
+{
+  pe_comb_t *combs;
+  cond_t **conds;      /* the conditions of the extension being built */
+  cond_t **cands;      /* candidates, followed by the narrowed lists */
+  int cands_size;
+  int *doms;           /* start and size of the list of every place, for
+                          every level of the comb */
+  pe_found_t *found;   /* NULL: extensions go straight into the queue */
+  long narrows, narrow_fails;  /* calls to pe_narrow and their time, */
+  double narrow_time;          /* for -stats */
+} pe_scratch_t;
+
 cond_t   **pe_conds;  /* array of conditions, given by pe() to pe_insert() */
 uchar     *pe0_conflicts; /* conflicts of the initial conditions */
 
+int pe_threads = 1;   /* argument of -j */
+int pe_stopped = 0;   /* the -T transition is in the queue, nothing else
+                         may be added */
+pe_scratch_t pe_main; /* scratch of the serial search */
+
+long pe_calls, pe_narrows, pe_narrow_fails;  /* for -stats */
+double pe_time, pe_narrow_time;
+int pe_qpeak;         /* largest size of the queue */
+
+/* worker threads for -j */
+pe_scratch_t *pe_scratches;
+pe_found_t *pe_results;
+int pe_results_alloc;
+cond_t **pe_work_conds; /* conditions handled in the current round */
+int pe_work_size, pe_work_next, pe_work_busy, pe_round;
+pthread_t *pe_workers;
+pthread_mutex_t pe_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pe_start = PTHREAD_COND_INITIALIZER;
+pthread_cond_t pe_done = PTHREAD_COND_INITIALIZER;
+
 /*****************************************************************************/
 /* Simple functions: initialize queue, release a queue entry, and release    */
 /* memory allocated during initialization.             */
 
-void pe_init (nodelist_t *m0)
+void pe_scratch_init (pe_scratch_t *sc, cond_t **conds)
+{
+  int levels = net->maxpre + net->maxres;
+
+  memset(sc,0,sizeof(pe_scratch_t));
+  sc->combs = MYmalloc(levels * sizeof(pe_comb_t));
+  sc->doms = MYmalloc(2 * levels * levels * sizeof(int));
+  sc->conds = conds? conds
+    : MYmalloc((net->maxpre + net->maxres) * sizeof(cond_t*));
+}
+
+void pe_scratch_free (pe_scratch_t *sc)
+{
+  pe_narrows += sc->narrows;
+  pe_narrow_fails += sc->narrow_fails;
+  pe_narrow_time += sc->narrow_time;
+  free(sc->combs);
+  if (sc->conds != pe_conds) free(sc->conds);
+  free(sc->cands);
+  free(sc->doms);
+}
+
+void pe_init (marking_t *m0)
 {
   int i;
 
@@ -37,24 +108,58 @@ void pe_init (nodelist_t *m0)
   pe_queue = MYmalloc((pe_qalloc = PE_ALLOC_STEP) * sizeof(pe_queue_t*));
   
   pe_conds = MYmalloc((net->maxpre + net->maxres) * sizeof(place_t*));
-  pe_combs = MYmalloc((net->maxpre + net->maxres) * sizeof(pe_comb_t));
+  pe_scratch_init(&pe_main,pe_conds);
+  if (pe_threads > 1)
+  {
+    pe_scratches = MYmalloc(pe_threads * sizeof(pe_scratch_t));
+    for (i = 0; i < pe_threads; i++)
+      pe_scratch_init(pe_scratches + i,NULL);
+  }
 
   /* determine size of initial marking */
-  for (i = 0; m0; m0 = m0->next) i++;
+  i = marking_size(m0);
   pe0_conflicts = MYcalloc((i + 8) / 8);
 }
 
 void pe_free (pe_queue_t *qu)
 {
+  if (qu->foata) foata_free(qu->foata);
+  free(qu->consumed);
   free(qu->conds);
   free(qu);
 }
 
 void pe_finish ()
 {
+  int i;
+
+  if (pe_workers)
+  { /* round -1 tells the workers to stop */
+    pthread_mutex_lock(&pe_lock);
+    pe_round = -1;
+    pthread_cond_broadcast(&pe_start);
+    pthread_mutex_unlock(&pe_lock);
+    for (i = 1; i < pe_threads; i++)
+      pthread_join(pe_workers[i],NULL);
+    free(pe_workers);
+    pe_workers = NULL;
+  }
+  if (pe_scratches)
+  {
+    for (i = 0; i < pe_threads; i++)
+      pe_scratch_free(pe_scratches + i);
+    free(pe_scratches);
+    pe_scratches = NULL;
+  }
+  for (i = 0; i < pe_results_alloc; i++)
+  {
+    free(pe_results[i].trans);
+    free(pe_results[i].conds);
+  }
+  free(pe_results);
+  pe_scratch_free(&pe_main);
   free(pe_conds);
   free(pe0_conflicts);
-  free(pe_combs);
 }
 
 /*****************************************************************************/
@@ -65,7 +170,6 @@ void pe_insert (trans_t *tr)
   pe_queue_t *qu_new = create_queue_entry(tr);
   
   int index = ++pe_qsize;
-  static char stoptr_found = 0;
   
   /* If -d is used, ignore the new event if its size exceeds the limit. */
   if (unfold_depth && qu_new->lc_size > unfold_depth)
@@ -78,9 +182,9 @@ void pe_insert (trans_t *tr)
   {
     while (--index) pe_free(pe_queue[index]);
     pe_queue[pe_qsize = 1] = qu_new;
-    stoptr_found = 1;
+    pe_stopped = 1;
   }
-  else if (stoptr_found)
+  else if (pe_stopped)
   {
     pe_qsize--;
     pe_free(qu_new); return;
@@ -100,6 +204,22 @@ void pe_insert (trans_t *tr)
       pe_queue[index] = pe_queue[index/2]; /* move parent downwards */
     }
   pe_queue[index] = qu_new; 
+  if (pe_qsize > pe_qpeak) pe_qpeak = pe_qsize;
+}
+
+/*****************************************************************************/
+/* Put qu at the end of the queue without restoring order; used to rebuild */
+/* a queue saved in heap order (checkpoint_load).         */
+
+void pe_append (pe_queue_t *qu)
+{
+  if (++pe_qsize >= pe_qalloc)
+  {
+    pe_qalloc += PE_ALLOC_STEP;
+    pe_queue = MYrealloc(pe_queue,pe_qalloc * sizeof(pe_queue_t*));
+  }
+  pe_queue[pe_qsize] = qu;
+  if (pe_qsize > pe_qpeak) pe_qpeak = pe_qsize;
 }
 
 /*****************************************************************************/
@@ -137,66 +257,116 @@ pe_queue_t* pe_pop (int where)
 }
 
 /*****************************************************************************/
-/* Check whether any pair of conditions downwards from curr is in conflict   */
-/* The check excludes the condition given to pe(), because we already know   */
-/* that that one is not in conflict with any of the others.        */
+/* The comb is enumerated with forward checking: the choice at level k     */
+/* narrows the lists of the places after it to the conditions concurrent   */
+/* to it. The narrowed lists are pushed behind the ones of level k and     */
+/* dropped again when the choice changes, so a condition reached at a      */
+/* deeper level is compatible with all choices before it, and a prefix     */
+/* that leaves some place without candidates is abandoned at once. The     */
+/* condition given to pe() is concurrent to all candidates anyway.       */
 
-char pe_conflict (pe_comb_t *curr)
+char pe_narrow (pe_scratch_t *sc, int k, int levels)
 {
-  int sz;
-  cond_t *co, **co_ptr;
-  event_t *ev, **queue;
+  int *from = sc->doms + 2 * k * levels, *to = from + 2 * levels;
+  int top = sc->combs[k].top, need = top, m, i;
+  cond_t *co = sc->cands[sc->combs[k].current], *co2;
+  double start = stats? wall_time() : 0;
 
-  /* just one condition - no conflict */
-  if (curr == pe_combs) return 0;  
+  for (m = k + 1; m < levels; m++) need += from[2*m+1];
+  if (need > sc->cands_size)
+  {
+    sc->cands_size = need * 2;
+    sc->cands = MYrealloc(sc->cands,sc->cands_size * sizeof(cond_t*));
+  }
 
-  ++ev_mark;
-  *(queue = events) = NULL;
+  for (m = k + 1; m < levels; m++)
+  {
+    to[2*m] = top;
+    for (i = from[2*m]; i < from[2*m] + from[2*m+1]; i++)
+      if (co_concurrent(co2 = sc->cands[i],co))
+        sc->cands[top++] = co2;
+    if (!(to[2*m+1] = top - to[2*m]))
+      break;
+  }
+  if (m == levels && k + 1 < levels) sc->combs[k+1].top = top;
+  if (stats)
+  {
+    sc->narrows++;
+    sc->narrow_fails += m < levels;
+    sc->narrow_time += wall_time() - start;
+  }
+  return m == levels;
+}
 
-  /* put the pre-events into the queue */
-  while (curr >= pe_combs)
+/*****************************************************************************/
+/* Record the possible extension (tr,sc->conds) found by a worker thread.   */
+
+void pe_found (pe_found_t *found, trans_t *tr, cond_t **conds)
+{
+  if (found->count == found->alloc)
   {
-    (co = (curr--)->current->node)->mark = ev_mark;
-    if ((ev = co->pre_ev) && ev->mark != ev_mark)
-       (*++queue = ev)->mark = ev_mark;
+    found->alloc = found->alloc * 2 + 8;
+    found->trans = MYrealloc(found->trans,found->alloc * sizeof(trans_t*));
   }
-  
-  /* go upwards, try to find two paths converging at some condition */  
-  while ((ev = *queue))
+  found->trans[found->count++] = tr;
+
+  if (found->used + tr->prereset_size > found->conds_alloc)
   {
-    queue--;
-    for (sz = ev->origin->prereset_size, co_ptr = ev->preset; sz--; )
-    {
-      if ((co = *co_ptr++)->mark == ev_mark)
-        return 1;
+    found->conds_alloc = (found->used + tr->prereset_size) * 2;
+    found->conds = MYrealloc(found->conds,found->conds_alloc * sizeof(cond_t*));
+  }
+  memcpy(found->conds + found->used,conds,tr->prereset_size * sizeof(cond_t*));
+  found->used += tr->prereset_size;
+}
+
+/*****************************************************************************/
+/* Collect the candidates among the conditions of coa that belong to pl2    */
+/* and can be consumed (or reset) by tr into the scratch buffer.      */
+/* Conditions created after co (its siblings that are handled after it)    */
+/* are left out, they will find the extensions containing co themselves.   */
 
-      co->mark = ev_mark;
-      if ((ev = co->pre_ev) && ev->mark != ev_mark)
-        (*++queue = ev)->mark = ev_mark;
+void pe_candidates (pe_scratch_t *sc, pe_comb_t *comb, cond_t *co,
+      coa_t *coa, place_t *pl2, uchar role)
+{
+  cond_t **cocoptr;
+
+  if (comb->start + comb->size + coa->inuse > sc->cands_size)
+  {
+    sc->cands_size = (comb->start + comb->size + coa->inuse) * 2;
+    sc->cands = MYrealloc(sc->cands,sc->cands_size * sizeof(cond_t*));
+  }
+
+  cocoptr = coa->conds - 1;
+  while (*++cocoptr)
+  {
+    if ((*cocoptr)->origin != pl2 || (*cocoptr)->num > co->num) continue;
+    if (((*cocoptr)->token && (role & ARC_PRE)) || (role & ARC_RESET))
+    {
+      if (confmax && (*cocoptr)->postset) continue;
+      sc->cands[comb->start + comb->size++] = *cocoptr;
     }
   }
-  return 0;
 }
 
 /*****************************************************************************/
-/* Find the new possible extensions created by the addition of co.       */
+/* Find the new possible extensions created by the addition of co, using   */
+/* the scratch space sc.                  */
 
-void pe (cond_t *co)
+void pe_search (pe_scratch_t *sc, cond_t *co)
 {
-  nodelist_t *pl_post = nodelist_alloc(), *tr_pre, **compat_conds;
   pe_comb_t *curr_comb;
-  cond_t **cocoptr;
   place_t *pl = co->origin, *pl2;
   trans_t *tr;
-  
-  *pe_conds = co; /* any new PE contains co */
-  nodelist_push(&(pl->conds),co);
-  /* check the transitions in pl's postset */
-  for (pl_post = nodelist_concatenate(pl->postset, pl->reset); pl_post; pl_post = pl_post->next)
+  int i, j, k, levels, *dom;
+
+  *sc->conds = co; /* any new PE contains co */
+  /* check the transitions in pl's postset and reset; the first
+     postset_size of them are the postset */
+  for (i = 0; i < pl->postreset_size; i++)
   {
-    tr = pl_post->node;
+    tr = pl->postreset_arr[i];
     
-    if ((!co->token && nodelist_find(pl->postset, pl_post->node)) || 
+    if ((!co->token && i < pl->postset_size) || 
       (tr->blocked))
       continue;
 
@@ -205,93 +375,192 @@ void pe (cond_t *co)
       continue;
 
     if (confmax && co->postset) continue;
-    
-    /* co_ptr2 = pe_conds;
-    printf("FROM place %s transition name %s  and its pe_conds: \n", pl->name, ((trans_t*)(pl_post->node))->name);
-    while(*co_ptr2){
-      printf("PE_COND condition name: %s and num %d\n",(*co_ptr2)->origin->name, (*co_ptr2)->num);
-      co_ptr2 = &((*co_ptr2)->next);
-    } */
 
-    (curr_comb = pe_combs)->start = NULL;
+    curr_comb = sc->combs;
+    curr_comb->start = curr_comb->size = 0;
 
     /* for every other post-place of tr, collect the conditions
       that are co-related to co in the comb structure */
-    for (tr_pre = nodelist_concatenate(tr->preset, tr->reset); tr_pre; tr_pre = tr_pre->next)
+    for (j = 0; j < tr->prereset_size; j++)
     {
-      if ((pl2 = tr_pre->node) == pl) continue;
-      
-      compat_conds = &(curr_comb->start);
-      cocoptr = co->co_common.conds - 1;
-      while (*++cocoptr){
-        
-        if ((*cocoptr)->origin == pl2){
-          
-          if (((*cocoptr)->token && nodelist_find(tr->preset, (*cocoptr)->origin)) ||
-            (nodelist_find(tr->reset, (*cocoptr)->origin))
-          )
-          { 
-            if (confmax && !(*cocoptr)->postset)
-              nodelist_push(compat_conds,*cocoptr);
-            else if (!confmax)
-              nodelist_push(compat_conds,*cocoptr);
-          }
-        }
-      }
-      
-      cocoptr = co->co_private.conds - 1;
-      while (*++cocoptr){
-        if ((*cocoptr)->origin == pl2){
-          if (((*cocoptr)->token && nodelist_find(tr->preset, (*cocoptr)->origin)) ||
-            (nodelist_find(tr->reset, (*cocoptr)->origin))
-          )
-          {
-            if (confmax && !(*cocoptr)->postset)
-              nodelist_push(compat_conds,*cocoptr);
-            else if (!confmax)
-              nodelist_push(compat_conds,*cocoptr);
-          }
-        }
-      }
+      uchar role;
+
+      if ((pl2 = tr->prereset_arr[j]) == pl) continue;
+      role = nc_arc_role(tr,pl2);
+
+      pe_candidates(sc,curr_comb,co,&co->co_common,pl2,role);
+      pe_candidates(sc,curr_comb,co,&co->co_private,pl2,role);
       
-      if (!*compat_conds)
+      if (!curr_comb->size)
         break;
 
-      curr_comb->current = curr_comb->start;
-      (++curr_comb)->start = NULL;
-      
+      curr_comb->current = curr_comb->start + curr_comb->size - 1;
+      (curr_comb+1)->start = curr_comb->start + curr_comb->size;
+      (++curr_comb)->size = 0;
     }
     
+    if (j < tr->prereset_size) continue;
+
     /* find all non-conflicting combinations in the comb */
-    curr_comb = pe_combs;
-    
-    if (!tr_pre) while (curr_comb >= pe_combs)
+    levels = curr_comb - sc->combs;
+    for (k = 0; k < levels; k++)
     {
-      if (!curr_comb->start)
+      sc->doms[2*k] = sc->combs[k].start;
+      sc->doms[2*k+1] = sc->combs[k].size;
+    }
+    if (levels) sc->combs->top = curr_comb->start;
+
+    k = 0;
+    while (k >= 0)
+    {
+      if (k == levels)
       {
-        cond_t **co_ptr = pe_conds;
-        for (curr_comb = pe_combs; curr_comb->start;
-            curr_comb++)
-          *++co_ptr = curr_comb->current->node;
-        pe_insert(tr);
-        curr_comb--;
+        cond_t **co_ptr = sc->conds;
+        for (k = 0; k < levels; k++)
+          *++co_ptr = sc->cands[sc->combs[k].current];
+        if (sc->found)
+          pe_found(sc->found,tr,sc->conds);
+        else
+          pe_insert(tr);
+        k--;
       }
-      else if (!pe_conflict(curr_comb))
+      else if (pe_narrow(sc,k,levels))
       {
-        curr_comb++;
+        if (++k < levels)
+        {
+          dom = sc->doms + 2 * (k * levels + k);
+          sc->combs[k].current = dom[0] + dom[1] - 1;
+        }
         continue;
       }
-      while (curr_comb >= pe_combs && !(curr_comb->current =
-            curr_comb->current->next))
-      {
-        curr_comb->current = curr_comb->start;
-        curr_comb--;
-      }
+      while (k >= 0 && --sc->combs[k].current
+          < sc->doms[2 * (k * levels + k)])
+        k--;
     }
-    
-    /* release the comb lists */
-    for (curr_comb = pe_combs; curr_comb->start; curr_comb++)
-      nodelist_delete(curr_comb->start);    
   }
-  
+}
+
+/*****************************************************************************/
+/* Find the new possible extensions created by the addition of co.       */
+
+void pe (cond_t *co)
+{
+  double start = stats? wall_time() : 0;
+
+  nodelist_push(&(co->origin->conds),co);
+  pe_search(&pe_main,co);
+  if (stats)
+  {
+    pe_calls++;
+    pe_time += wall_time() - start;
+  }
+}
+
+/*****************************************************************************/
+/* Parallel search (-j): the postset conditions of a new event are handed   */
+/* out to the threads one at a time; every thread works in its own scratch  */
+/* space and keeps the extensions it finds per condition. Only then are    */
+/* they put into the queue, condition by condition, so that the queue sees  */
+/* the same insertions in the same order as with the serial search.     */
+
+void pe_work (pe_scratch_t *sc)
+{
+  int i;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&pe_lock);
+    i = pe_work_next < pe_work_size ? pe_work_next++ : -1;
+    pthread_mutex_unlock(&pe_lock);
+    if (i < 0) break;
+
+    sc->found = pe_results + i;
+    pe_search(sc,pe_work_conds[i]);
+  }
+}
+
+void* pe_worker (void *arg)
+{
+  pe_scratch_t *sc = arg;
+  int round = 0;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&pe_lock);
+    while (pe_round == round) pthread_cond_wait(&pe_start,&pe_lock);
+    if ((round = pe_round) < 0)
+    {
+      pthread_mutex_unlock(&pe_lock);
+      return NULL;
+    }
+    pthread_mutex_unlock(&pe_lock);
+
+    pe_work(sc);
+
+    pthread_mutex_lock(&pe_lock);
+    if (!--pe_work_busy) pthread_cond_signal(&pe_done);
+    pthread_mutex_unlock(&pe_lock);
+  }
+}
+
+void pe_parallel (cond_t **conds, int size)
+{
+  pe_found_t *found;
+  int i, j, used;
+  double start = stats? wall_time() : 0;
+
+  if (size < 2 || pe_threads < 2)
+  {
+    for (i = 0; i < size; i++) pe(conds[i]);
+    return;
+  }
+
+  if (!pe_workers)
+  {
+    pe_workers = MYmalloc(pe_threads * sizeof(pthread_t));
+    for (i = 1; i < pe_threads; i++)
+      if (pthread_create(pe_workers + i,NULL,pe_worker,pe_scratches + i))
+        nc_error("cannot create thread");
+  }
+  if (size > pe_results_alloc)
+  {
+    pe_results = MYrealloc(pe_results,size * sizeof(pe_found_t));
+    memset(pe_results + pe_results_alloc,0,
+      (size - pe_results_alloc) * sizeof(pe_found_t));
+    pe_results_alloc = size;
+  }
+  for (i = 0; i < size; i++)
+  {
+    nodelist_push(&(conds[i]->origin->conds),conds[i]);
+    pe_results[i].count = pe_results[i].used = 0;
+  }
+
+  pthread_mutex_lock(&pe_lock);
+  pe_work_conds = conds;
+  pe_work_size = size;
+  pe_work_next = 0;
+  pe_work_busy = pe_threads - 1;
+  pe_round++;
+  pthread_cond_broadcast(&pe_start);
+  pthread_mutex_unlock(&pe_lock);
+
+  pe_work(pe_scratches);
+
+  pthread_mutex_lock(&pe_lock);
+  while (pe_work_busy) pthread_cond_wait(&pe_done,&pe_lock);
+  pthread_mutex_unlock(&pe_lock);
+
+  for (i = 0; i < size; i++)
+    for (found = pe_results + i, used = j = 0; j < found->count; j++)
+    {
+      memcpy(pe_conds,found->conds + used,
+        found->trans[j]->prereset_size * sizeof(cond_t*));
+      used += found->trans[j]->prereset_size;
+      pe_insert(found->trans[j]);
+    }
+  if (stats)
+  {
+    pe_calls += size;
+    pe_time += wall_time() - start;
+  }
 }
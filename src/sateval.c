@@ -10,27 +10,7 @@
 #include <fcntl.h>
 #include <assert.h>
 
-char *bpos;
-
-static unsigned int read_int ()
-{
-  int i = *(int*)bpos;
-  bpos += sizeof(int);
-  return i;
-}
-
-static void read_str ()
-{
-  while (*bpos++);
-}
-
-typedef struct cut_t
-{
-  int repeat;
-  int szcut, szevscut;
-  int *cut;
-  int *evscut;
-} cut_t;
+#include "mciread.h"
 
 int numpl, numtr, events, conds;
 int evars;    // highest variable index used for events
@@ -38,7 +18,8 @@ int *co2pl;   // maps conditions to place indices
 int *ev2tr;   // maps non-cutoff events to transition indices
 int *marking; // records the current marking when fetching a reachable marking.
 int *cut; // records the current cut when fetching a reachable marking.
-int **coxev;  // records the prefix
+int *initcut, numinit; // conditions of the initial cut
+mci_t *mci;   // the prefix, with the pre- and postset of every event
 
 char **plname, **trname;    // names of conditions/transitions
 
@@ -48,134 +29,53 @@ char opt_reach = 0; // perform reachability (=1) or deadlock (=0)
 
 void readmci (const char * infile)
 {
-  int i, cutoffs = 0;
-  char *blob;
-  int *queries_ev, *harmfuls;
-  int nqure, nqure_, nquszcut, nquszevscut, szcuts, harmful, token, queried, pre_ev, post_ev;
-  cut_t **cuts;
-
-  /* open input and output files */
-  struct stat statbuf;
-  stat(infile,&statbuf);
-  blob = malloc(statbuf.st_size);
-  int fd = open(infile,O_RDONLY);
-  read(fd,blob,statbuf.st_size);
-  close(fd);
-  bpos = blob;
-
-  // start reading mci file
-  conds = read_int();
-  events = read_int();
-  /* printf("conds: %d\n", conds);
-  printf("events: %d\n", events); */
-
-  // read mapping of events to transitions
-  co2pl = malloc((conds+1) * sizeof(int));
-  ev2tr = malloc((events+1) * sizeof(int));
-  queries_ev = malloc((events+1) * sizeof(int));
-  harmfuls = calloc(events+1, sizeof(int));
-  coxev = calloc(conds+1, sizeof(int*));
-  for (i = 0; i <= conds; i++) {
-    coxev[i] = calloc(events+1, sizeof(int));
-  }
-
-  nqure = read_int();
-  nqure_ = abs(nqure);
-  cuts = calloc((szcuts = nqure_+1), sizeof(cut_t*));
-  while(nqure_)
-  {
-    nquszcut = read_int();
-    nquszevscut = read_int();
-    cuts[nqure_] = malloc(sizeof(cut_t));
-    cuts[nqure_]->repeat = nqure;
-    cuts[nqure_]->szcut = nquszcut;
-    cuts[nqure_]->szevscut = nquszevscut;
-    cuts[nqure_]->cut = calloc(nquszcut+1, sizeof(int));
-    cuts[nqure_]->evscut = calloc(nquszevscut+1, sizeof(int));
-    for (i = 1; i <= nquszcut; i++)
-      cuts[nqure_]->cut[i] = read_int();
-    for (i = 1; i <= nquszevscut; i++)
-      cuts[nqure_]->evscut[i] = read_int();
-    nqure = read_int();
-    nqure_ = abs(nqure);
-  }
-
-  // read events
-  for (i = 1; i <= events; i++)
-  {
-    ev2tr[i] = read_int();
-    queries_ev[i] = read_int();
-  }
-
-  // read conditions
+  int i;
+
+  mci = mci_read(infile,0);
+  conds = mci->numco;
+  events = mci->numev;
+  numpl = mci->numpl;
+  numtr = mci->numtr;
+  co2pl = mci->co2pl;
+  ev2tr = mci->ev2tr;
+  plname = mci->plname;
+  trname = mci->trname;
+  evars = events - mci->numcutoffs;
+
+  // conditions with a token produced by no event
+  initcut = calloc(conds+1, sizeof(int));
   for (i = 1; i <= conds; i++)
-  {
-    co2pl[i] = read_int();
-    token = read_int();
-    queried =  read_int();
-    pre_ev =  read_int();
-
-    if(!token)
-    {
-      while (read_int());
-      token = queried; // rm warning unused variables
-      continue;
-    }
+    if (mci->co_token[i] && !mci->co_pre[i]) initcut[numinit++] = i;
 
-    post_ev = read_int();
-    if(pre_ev) coxev[i][pre_ev] = co2pl[i];
-    else if (!pre_ev && !post_ev) coxev[i][0] = co2pl[i];
-    while(token && post_ev)
-    {
-      if (!pre_ev){ 
-        coxev[i][0] = co2pl[i];
-        coxev[i][post_ev] = co2pl[i]*-1;
-      }
-      else coxev[i][post_ev] = co2pl[i]*-1;
-      post_ev = read_int();
-    }
-  }
-
-  /* for (i = 1; i <= conds; i++){
-    if (i<10) printf("%d:  ", i);
-    else printf("%d: ", i);
-    for (int j = 0; j <= events; j++)
-      printf("%d ", coxev[i][j]);
-    printf("\n");
-  } */
+  marking = calloc(numpl+1, sizeof(int));
+  cut = calloc(numpl+1, sizeof(int));
+}
 
-  for (;;) {
-    harmful = read_int();
-    if (!harmful) break;
-    harmfuls[harmful] = harmful;
-  }
+/* Fire event v on the current marking: the conditions it consumes and
+   produces are visited in increasing order, a consumed condition clears
+   the mark of its place and a produced one sets it. */
 
-  // skip cutoff information
-  while ((i = read_int())) { cutoffs++; read_int(); }
-  evars = events - cutoffs;
-  //printf("events: %d\n", events);
-  //printf("evars: %d\n", evars);
-  //printf("cutoffs: %d\n", cutoffs);
-  // dummy ints followed by number of places and transitions
-  while (read_int());
-  numpl = read_int();
-  numtr = read_int();
-  read_int();
+void replay (int v)
+{
+  int *pre = mci->ev_pre + mci->ev_preidx[v];
+  int *pre_end = mci->ev_pre + mci->ev_preidx[v+1];
+  int *post = mci->ev_post + mci->ev_postidx[v];
+  int *post_end = mci->ev_post + mci->ev_postidx[v+1];
+  int i, place, consumed;
 
-  // read place names
-  plname = malloc((numpl+1) * sizeof(char*));
-  for (i = 1; i <= numpl; i++) 
-  { 
-    read_int(); plname[i] = bpos; read_str();  
-  }
-  bpos++;
-  // read transition names
-  trname = malloc((numtr+1) * sizeof(char*));
-  for (i = 1; i <= numtr; i++)
-  { 
-    read_int(); trname[i] = bpos; read_str(); 
+  while (pre < pre_end || post < post_end)
+  {
+    if ((consumed = post == post_end || (pre < pre_end && *pre < *post)))
+      i = *pre++;
+    else
+      i = *post++;
+    if (!mci->co_token[i]) continue;
+    place = co2pl[i];
+    if (consumed && marking[place] == place)
+      {marking[place] = 0; cut[place] = 0;}
+    else
+      {marking[place] = place; cut[place] = i;}
   }
-  //bpos++;
 }
 
 int sateval (char *resfile, int verbose)
@@ -198,10 +98,9 @@ int sateval (char *resfile, int verbose)
   strcpy(idx, ".evco");
   evcofile = strdup(tmpname);
   FILE *fo = fopen(evcofile,"w");
+  free(tmpname); free(evcofile);
 
-  int i, place;
-  marking = calloc(numpl+1, sizeof(int));
-  cut = calloc(numpl+1, sizeof(int));
+  int i;
   char c = getc(f);
   int v;
 
@@ -212,6 +111,7 @@ int sateval (char *resfile, int verbose)
     else if (verbose)
       printf("The net is alive.\n");
     fclose(f);
+    fclose(fo);
     return 0;
   }
   else
@@ -224,6 +124,7 @@ int sateval (char *resfile, int verbose)
     {
       if (opt_reach && verbose) printf("Marking unreachable.\n");
       fclose(f);
+      fclose(fo);
       return 0;
     }
     else if (opt_reach && verbose)
@@ -232,11 +133,13 @@ int sateval (char *resfile, int verbose)
       printf("Deadlock sequence:");
   }
 
-  for (i = 1; i <= conds; i++)
-    if (coxev[i][0]){
-      marking[coxev[i][0]] = coxev[i][0];
-      cut[coxev[i][0]] = i;
-    }
+  memset(marking, 0, (numpl+1)*sizeof(int));
+  memset(cut, 0, (numpl+1)*sizeof(int));
+  for (i = 0; i < numinit; i++)
+  {
+    marking[co2pl[initcut[i]]] = co2pl[initcut[i]];
+    cut[co2pl[initcut[i]]] = initcut[i];
+  }
 
   while (fscanf(f," %d",&v) != EOF)
   {
@@ -247,17 +150,7 @@ int sateval (char *resfile, int verbose)
     if (v < 0) continue;
     if (verbose) printf(" %s (e%d)",trname[ev2tr[v]],v);
     fprintf(fo,"%d ",v);
-    for (i = 1; i <= conds; i++)
-    {
-      if (coxev[i][v])
-      {
-        place = abs(coxev[i][v]);
-        if (coxev[i][v] < 0 && marking[place] == place)
-          {marking[place] = 0; cut[place] = 0;}
-        else
-          {marking[place] = place; cut[place] = i;}
-      }
-    }
+    replay(v);
   }
   if (verbose) printf("\n\t");
   fprintf(fo,"0\n");
@@ -279,37 +172,40 @@ int sateval (char *resfile, int verbose)
 void usage ()
 {
   fprintf(stderr,
-  "\nusage: sateval {-d|-r} <mcifile> <resfile>\n\n"
+  "\nusage: sateval {-d|-r} <mcifile> <resfile> ...\n\n"
   "  options:\n"
   "\t-d or -r: output for deadlock or reachability checking\n"
   "\t-verbose: printing info and evco file is still given.\n\n"
+  "  Every <resfile> is evaluated against the same prefix and gets its\n"
+  "  own evco file. The exit status is 1 if some marking is reachable.\n\n"
   );
   exit(1);
 }
 
 int main (int argc, char ** argv)
 {
-  char outfile[1024];
   int reachable = 0;
   int verbose = 0;
   char *mcifile = NULL;
-  char *resfile = NULL;
-
-  *outfile = 0;
+  char **resfiles = calloc(argc, sizeof(char*));
+  int numres = 0;
 
   for (int i = 1; i < argc; i++)
-    if (argc != 4 && argc != 5) usage();
-    else if (!strcmp(argv[i],"-r")) opt_reach = 1;
+    if (!strcmp(argv[i],"-r")) opt_reach = 1;
+    else if (!strcmp(argv[i],"-d")) opt_reach = 0;
     else if (!strcmp(argv[i],"-verbose")) verbose = 1;
-    else if (i+1 < argc) mcifile = argv[i];
-    else resfile = argv[i];
+    else if (!mcifile) mcifile = argv[i];
+    else resfiles[numres++] = argv[i];
+  if (!numres) usage();
 
-  /* if (strcmp(argv[1],"-d") && strcmp(argv[1],"-r")) usage();
-  if (!strcmp(argv[1],"-r")) opt_reach = 1; */
-  
   readmci(mcifile);
-  reachable = sateval(resfile, verbose);
-  //printf("sateval is: %d\n", reachable);
+  for (int i = 0; i < numres; i++)
+  {
+    if (verbose && numres > 1) printf("%s:\n", resfiles[i]);
+    reachable |= sateval(resfiles[i], verbose);
+  }
+  mci_free(mci);
+  free(initcut); free(marking); free(cut); free(resfiles);
 
   return reachable;
 }
@@ -0,0 +1,105 @@
+/****************************************************************************/
+/* stats.c								    */
+/*									    */
+/* The report of -stats-json: the counters and timers that the other      */
+/* modules keep while statistics are on, written as one JSON object so    */
+/* that runs can be compared from one release to the next. Times are in   */
+/* seconds and include the functions called by the one measured.	    */
+/****************************************************************************/
+
+#include <stdio.h>
+#include <sys/resource.h>
+
+#include "common.h"
+#include "netconv.h"
+#include "unfold.h"
+
+char *stats_json = NULL;  /* argument of -stats-json */
+
+static FILE *stats_out;
+
+static void json_string (const char *str)
+{
+  fputc('"',stats_out);
+  for (; *str; str++)
+    if (*str == '"' || *str == '\\')
+      fprintf(stats_out,"\\%c",*str);
+    else if ((unsigned char) *str < 32)
+      fprintf(stats_out,"\\u%04x",*str);
+    else
+      fputc(*str,stats_out);
+  fputc('"',stats_out);
+}
+
+static void json_timer (const char *name, long calls, double time, int last)
+{
+  fprintf(stats_out,"    \"%s\": { \"calls\": %ld, \"seconds\": %.6f }%s\n",
+    name, calls, time, last ? "" : ",");
+}
+
+/* Write the report on the unfolding of 'netfile' to 'filename'. The
+   unfolding must still be in memory. */
+
+void stats_write (char *filename, char *netfile)
+{
+  struct rusage usage;
+  cond_t *co;
+  long cosets = 0, cosum = 0, comax = 0, n;
+  int cutoffs = nodelist_size(cutoff_list);
+
+  if (!(stats_out = fopen(filename,"w")))
+    nc_error("cannot write to file %s",filename);
+
+  /* the number of conditions concurrent to each condition that has
+     gone through pe() */
+  for (co = unf->conditions; co; co = co->next)
+    if (co->co_private.conds)
+    {
+      n = co->co_common.inuse + co->co_private.inuse;
+      cosets++;
+      cosum += n;
+      if (n > comax) comax = n;
+    }
+  getrusage(RUSAGE_SELF,&usage);
+
+  fprintf(stats_out,"{\n  \"net\": ");
+  json_string(netfile);
+  fprintf(stats_out,",\n  \"criterion\": \"%s\",\n",
+    mcmillan ? "mcmillan" : "erv");
+  fprintf(stats_out,"  \"cobits\": %s,\n  \"threads\": %d,\n",
+    co_bitsets ? "true" : "false", pe_threads);
+  fprintf(stats_out,"  \"complete\": %s,\n", budget_hit ? "false" : "true");
+  fprintf(stats_out,"  \"seconds\": %.6f,\n", unfold_time);
+  fprintf(stats_out,"  \"events\": %d,\n  \"conditions\": %d,\n",
+    unf->numev, unf->numco);
+  fprintf(stats_out,"  \"cutoffs\": %d,\n  \"cutoff_ratio\": %.6f,\n",
+    cutoffs, unf->numev ? (double) cutoffs / unf->numev : 0.0);
+  fprintf(stats_out,"  \"harmful\": %d,\n", nodelist_size(harmful_list));
+
+  fprintf(stats_out,"  \"functions\": {\n");
+  json_timer("pe",pe_calls,pe_time,0);
+  json_timer("pe_narrow",pe_narrows,pe_narrow_time,0);
+  json_timer("co_relation",co_relation_calls,co_relation_time,0);
+  json_timer("create_queue_entry",create_queue_calls,create_queue_time,0);
+  json_timer("foata_compare",foata_compares,foata_time,0);
+  json_timer("add_marking",add_marking_calls,add_marking_time,1);
+  fprintf(stats_out,"  },\n");
+
+  fprintf(stats_out,"  \"queue\": { \"entries\": %d, \"peak\": %d, "
+    "\"left\": %d, \"narrowings_pruned\": %ld, \"foata_cached\": %d },\n",
+    queue_count, pe_qpeak, budget_hit ? budget_pending : 0,
+    pe_narrow_fails, foata_cached);
+  fprintf(stats_out,"  \"marking_table\": { \"markings\": %d, "
+    "\"slots\": %d, \"resizes\": %d, \"lookups\": %lld, \"probes\": %lld, "
+    "\"max_probe\": %d },\n", hash_count, hash_buckets, hash_resizes,
+    hash_lookups, hash_probes, hash_maxprobe);
+  fprintf(stats_out,"  \"co_relation\": { \"found\": %ld, "
+    "\"conditions\": %ld, \"mean_size\": %.3f, \"max_size\": %ld, "
+    "\"array_bytes\": %ld },\n", co_relation_found, cosets,
+    cosets ? (double) cosum / cosets : 0.0, comax, coa_bytes);
+  fprintf(stats_out,"  \"memory\": { \"peak_rss_kb\": %ld, "
+    "\"arena_kb\": %ld }\n}\n", usage.ru_maxrss,
+    (long)(unf->arena->total / 1024));
+
+  if (fclose(stats_out)) nc_error("cannot write to file %s",filename);
+}
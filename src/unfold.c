@@ -1,5 +1,7 @@
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
 
 #include "common.h"
 #include "netconv.h"
@@ -8,7 +10,6 @@
 net_t *net; /* stores the net */
 unf_t *unf; /* stores the unfolding */
 
-#define CO_ALLOC_STEP 1024
 
 int exitcode = 0;
 int conditions_size, events_size, ce_alloc_step;
@@ -27,9 +28,13 @@ int verbose = 0;     /* enabling Ecofolder to print info (-verbose)    */
 int freechk = 0;       /* enabling Ecofolder to do a freeness check */
 int useids = 0;       /* enabling Ecofolder to use ids given in the input
                        file for places and transitions. */
-int conflsteps = 0;   /* allocating blocks of CO_ALLOC_STEP Bytes */
-int** confl_evs = NULL;  /* matrix of events X conditions whether they are 
-                          in direct conflict*/
+int stats = 0;        /* report statistics about the run (-stats) */
+double max_time = 0;  /* argument of -timeout, in seconds */
+int max_events = 0;   /* argument of -max-events */
+long max_mem = 0;     /* argument of -max-mem, in kB */
+int budget_hit = 0;   /* BUDGET_* that cut the run short, or 0 */
+int budget_pending;   /* possible extensions left when it did */
+double unfold_time;   /* time spent in unfold(), for -stats */
 char* badunf = NULL;
 char* qrmarking = NULL;
 char* rtplaces = NULL;
@@ -49,14 +54,67 @@ nodelist_t *harmful_list; /* list of bad/harmful events */
   additional conditions which do not (necessarily) enjoy this property.
 */
 
+/*
+  The arrays are cut from the unfolding's arena in size classes that 
+  grow by 25%. Arrays that are no longer needed are put into a free 
+  list for their class (linked through their first entry) and reused.
+*/
+
+#define COA_CLASSES 89 /* the largest class has about 10^9 entries */
+
+int coa_sizes[COA_CLASSES];  /* number of entries of each class */
+cond_t **coa_freelist[COA_CLASSES];
+long coa_bytes;       /* memory used by co-arrays, for -stats */
+
+/* Return the smallest class with at least 'size' entries. */
+int coa_class (int size)
+{
+  int lo = 0, hi = COA_CLASSES-1, mid;
+
+  if (!coa_sizes[0])
+    for (coa_sizes[0] = 1, mid = 1; mid < COA_CLASSES; mid++)
+      coa_sizes[mid] = coa_sizes[mid-1] + 1 + coa_sizes[mid-1]/4;
+
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if (coa_sizes[mid] < size) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+cond_t** coa_get (int class)
+{
+  cond_t **conds;
+
+  if ((conds = coa_freelist[class]))
+  {
+    coa_freelist[class] = (cond_t**)conds[0];
+    return conds;
+  }
+  coa_bytes += coa_sizes[class] * sizeof(cond_t*);
+  return arena_alloc(unf->arena, coa_sizes[class] * sizeof(cond_t*));
+}
+
+/* Return the memory of a coarray to the pool. */
+void free_coarray (coa_t *coa)
+{
+  int class = coa_class(coa->size+1);
+
+  coa->conds[0] = (cond_t*)coa_freelist[class];
+  coa_freelist[class] = coa->conds;
+  coa->conds = NULL;
+}
+
 /* Create an empty coarray with 'size' allocated events. */
 coa_t alloc_coarray (int size)
 {
   coa_t coa;
+  int class = coa_class(size+1);
 
-  coa.size = size;
+  coa.size = coa_sizes[class]-1;
   coa.inuse = 0;
-  coa.conds = MYmalloc((size+1) * sizeof(cond_t*));
+  coa.conds = coa_get(class);
   coa.conds[0] = NULL;
   return coa;
 }
@@ -68,22 +126,54 @@ void addto_coarray (coa_t *coa, cond_t *co)
 {
   if (coa->size == coa->inuse)
   {
-    int nsz = coa->size + 1 + coa->size/4;
-    coa->conds = MYrealloc(coa->conds,(nsz+1) * sizeof(cond_t*));
-    coa->size = nsz;
+    coa_t ncoa = alloc_coarray(coa->size + 1);
+    memcpy(ncoa.conds,coa->conds,coa->inuse * sizeof(cond_t*));
+    ncoa.inuse = coa->inuse;
+    free_coarray(coa);
+    *coa = ncoa;
   }
   coa->conds[coa->inuse++] = co;
   coa->conds[coa->inuse] = NULL;
 }
 
+/* Whether a condition with the given number is in the array; the 
+   arrays are sorted by condition numbers. */
+int coarray_find (coa_t *coa, int num)
+{
+  int lo = 0, hi = coa->inuse, mid;
+
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if (coa->conds[mid]->num < num) lo = mid + 1; else hi = mid;
+  }
+  return lo < coa->inuse && coa->conds[lo]->num == num;
+}
+
+/* Whether b is in the co-relation of a. */
+int co_concurrent (cond_t *a, cond_t *b)
+{
+  if (co_bitsets)
+    return cobits_test(cobits_common + a->num,b->num)
+      || cobits_test(cobits_private + a->num,b->num);
+  return coarray_find(&a->co_common,b->num)
+    || coarray_find(&a->co_private,b->num);
+}
+
+/* Record that 'other' is concurrent to co, in co's private part. */
+void add_private (cond_t *co, cond_t *other)
+{
+  addto_coarray(&(co->co_private),other);
+  if (co_bitsets) cobits_add_private(co,other);
+}
+
 /* Copy an array, truncating it to the necessary size. */
 coa_t coarray_copy (coa_t coa)
 {
-  coa_t ncoa;
+  coa_t ncoa = alloc_coarray(coa.inuse);
 
-  ncoa.size = ncoa.inuse = coa.inuse;
-  ncoa.conds = MYmalloc((ncoa.size+1) * sizeof(cond_t*));
-  memcpy(ncoa.conds,coa.conds,(ncoa.size+1) * sizeof(cond_t*));
+  ncoa.inuse = coa.inuse;
+  memcpy(ncoa.conds,coa.conds,(ncoa.inuse+1) * sizeof(cond_t*));
   return ncoa;
 }
 
@@ -101,6 +191,22 @@ void print_events (event_t* list)
   print_events(list->next);
 }
 
+/**************************************************************/
+/* Add an event to the events leading to a query cut. The list is
+kept sorted by decreasing event number, the event-less minimal
+conditions (ev NULL) at its end, so that the .mci output does not
+depend on where the events were allocated. */
+
+void evscut_insert (nodelist_t **list, event_t *ev)
+{
+  while (*list && (*list)->node &&
+    (!ev || ev->num < ((event_t*)(*list)->node)->num))
+    list = &((*list)->next);
+  if (*list && (*list)->node == ev) return;
+
+  nodelist_push(list,ev);
+}
+
 /**************************************************************/
 /* Insert a condition into the unfolding. The new condition is 
 labelled with the place pl. */
@@ -108,7 +214,7 @@ labelled with the place pl. */
 cond_t* insert_condition (place_t *pl, event_t *ev, int queried,
   int queryable)
 {
-  cond_t *co = MYmalloc(sizeof(cond_t));
+  cond_t *co = arena_alloc(unf->arena,sizeof(cond_t));
   co->next = unf->conditions;
   unf->conditions = co;
 
@@ -120,6 +226,7 @@ cond_t* insert_condition (place_t *pl, event_t *ev, int queried,
   co->pre_ev = ev;
   co->mark = 0;
   co->num = unf->numco++;
+  if (co_bitsets) cobits_new_condition(co);
   //if(unf->conditions) printf("plname: %s\n", ((cond_t*)(unf->conditions))->origin->name);
   //if(unf->conditions) printf("conum: %d\n", ((cond_t*)(unf->conditions))->num);
   co->queried = queried ? 1 : 0;
@@ -129,7 +236,7 @@ cond_t* insert_condition (place_t *pl, event_t *ev, int queried,
     printf("co->queried: %d\n", co->queried);
   } */
   if(ev && co->queried) co->pre_ev->queried = 1;
-  if ((ev && nodelist_find(ev->origin->postset, pl)) ||
+  if ((ev && (nc_arc_role(ev->origin, pl) & ARC_POST)) ||
     (!ev && pl->marked))
     co->token = 1;
   else
@@ -143,10 +250,11 @@ cond_t* insert_condition (place_t *pl, event_t *ev, int queried,
   }
   if(queryable)
   {
-    if(ev) nodelist_insert(&((*query)->evscut),ev);
+    if(ev) evscut_insert(&((*query)->evscut),ev);
     nodelist_push(&((*query)->cut),co);
     (*query)->szcut++;
   }
+  if (mcistream) mci_stream_condition(co);
   return co;
 }
 
@@ -157,7 +265,7 @@ cond_t* insert_condition (place_t *pl, event_t *ev, int queried,
 event_t* insert_event (pe_queue_t *qu, char* trans_pool)
 {
   
-  event_t *ev = MYmalloc(sizeof(event_t));
+  event_t *ev = arena_alloc(unf->arena,sizeof(event_t));
   int sz = qu->trans->prereset_size;
     cond_t **co_ptr;
 
@@ -169,11 +277,13 @@ event_t* insert_event (pe_queue_t *qu, char* trans_pool)
   ev->mark = 0;   /* for marking_of */
   ev->queried = 0;
   ev->foata_level = find_foata_level(qu);
+  ev->lc_size = qu->lc_size;
+  ev->p_vector = qu->p_vector;
   ev->preset_size = qu->trans->prereset_size;
   ev->postset_size = qu->trans->postreset_size;
 
   /* add preset (postset comes later) */
-        ev->preset = co_ptr = MYmalloc(sz * sizeof(cond_t*));
+  ev->preset = co_ptr = arena_alloc(unf->arena,sz * sizeof(cond_t*));
   memcpy(ev->preset,qu->conds,sz * sizeof(cond_t*));
   
   /*if (ev) printf("ev name: %s\n", ev->origin->name);
@@ -191,6 +301,9 @@ event_t* insert_event (pe_queue_t *qu, char* trans_pool)
     nodelist_push(&((*co_ptr++)->postset),ev);
   }
   
+  ev->num = unf->numev;
+  ev->history = mcmillan? cobits_history(ev) : NULL;
+
   /* allocate memory for queue in conco_nt if necessary */
   if (++unf->numev >= events_size)
   {
@@ -202,6 +315,7 @@ event_t* insert_event (pe_queue_t *qu, char* trans_pool)
   {
     printf("Added event E%d.\n",ev->id);
   }
+  if (mcistream) mci_stream_event(ev);
   
   return ev;
 }
@@ -217,17 +331,19 @@ void add_post_conditions (event_t *ev, char cutoff, int queried,
 {
   
   cond_t **co_ptr, **cocoptr;
-  nodelist_t *list;
+  place_t **pl_ptr = ev->origin->postreset_arr;
+  int i, sz = ev->postset_size;
   coa_t newarray;
+  cobits_t newbits;
   /* First insert the conditions without putting them in pl->conds;
-     that is done by pe() to avoid duplicated new events. */
+     that is done by pe() to avoid duplicated new events. The first
+     postset_size places are the postset, the others are resets. */
   ev->postset = co_ptr
-    = MYmalloc(ev->postset_size * sizeof(cond_t*));
-  for (list = nodelist_concatenate(ev->origin->postset, 
-    ev->origin->reset); list; list = list->next)
+    = arena_alloc(unf->arena,sz * sizeof(cond_t*));
+  for (i = 0; i < sz; i++)
   {
-    int tmp_find = nodelist_find(ev->origin->postset, list->node);
-    *co_ptr++ = insert_condition(list->node,ev, 
+    int tmp_find = i < ev->origin->postset_size;
+    *co_ptr++ = insert_condition(pl_ptr[i],ev, 
       tmp_find ? queried : 0, tmp_find ?
       queryable : 0);
   }
@@ -238,35 +354,37 @@ void add_post_conditions (event_t *ev, char cutoff, int queried,
      conditions in co_relation(), we create a copy that uses only
      the necessary amount of memory. */
   newarray = coarray_copy(ev->coarray); 
-  free(ev->coarray.conds);
+  free_coarray(&(ev->coarray));
+  if (co_bitsets) newbits = cobits_from_coarray(newarray);
   /* Add the reverse half of the concurrency relation. */
   cocoptr = newarray.conds-1;
   while (*++cocoptr)
   {
     co_ptr = ev->postset;
-    for (list = nodelist_concatenate(ev->origin->postset, 
-          ev->origin->reset); list; list = list->next)
-      addto_coarray(&((*cocoptr)->co_private),*co_ptr++);
+    for (i = 0; i < sz; i++)
+      add_private(*cocoptr,*co_ptr++);
   }
   
   co_ptr = ev->postset;
 
-  for (list = nodelist_concatenate(ev->origin->postset, 
-      ev->origin->reset); list; list = list->next)
+  for (i = 0; i < sz; i++)
   {
     /* record co-relation between new conditions */
     (*co_ptr)->co_common = newarray;
     (*co_ptr)->co_private = alloc_coarray(0);
+    if (co_bitsets) cobits_common[(*co_ptr)->num] = newbits;
     cocoptr = ev->postset;
     while (cocoptr != co_ptr)
     {
-      addto_coarray(&((*co_ptr)->co_private),*cocoptr);
-      addto_coarray(&((*cocoptr)->co_private),*co_ptr);
+      add_private(*co_ptr,*cocoptr);
+      add_private(*cocoptr,*co_ptr);
       cocoptr++;
     }
     
-    pe(*co_ptr++);
+    if (pe_threads == 1) pe(*co_ptr);
+    co_ptr++;
   }
+  if (pe_threads > 1) pe_parallel(ev->postset,sz);
 }
 
 /******************************************************************/
@@ -279,132 +397,141 @@ void add_post_conditions (event_t *ev, char cutoff, int queried,
   to the input conditions of ev. 
 */
 
-typedef struct cqentry_t {
-  cond_t *co;
-  int index;
-  struct cqentry_t *next;
-} cqentry_t;
+/*
+  The co-conditions of a condition form one sequence sorted by 
+  condition numbers: the common array followed by the private one. 
+  A cursor walks through that sequence.
+*/
+typedef struct cocursor_t {
+  cond_t **common, **private;
+  int ncommon, size;  /* size of the common part / of the whole */
+  int pos;
+} cocursor_t;
+
+#define COCURSOR_AT(c,i) ((i) < (c)->ncommon ? \
+  (c)->common[i] : (c)->private[(i) - (c)->ncommon])
+
+cocursor_t *cocursors;  /* one per preset condition, for co_relation */
+
+long co_relation_calls, co_relation_found;  /* for -stats */
+double co_relation_time;
 
 /* 
-  This maintains a queue of conditions used for computing the 
-  intersection. 
+  Move the cursor forward to the first condition whose number is at 
+  least num, by galloping (doubling the step, then binary search). 
+  Returns 0 if there is no such condition. 
 */
-void insert_to_queue (cqentry_t **queue, cqentry_t *newentry,
-      cond_t *co, int index)
+int cocursor_seek (cocursor_t *c, int num)
 {
-  newentry->co = co;
-  newentry->index = index;
+  int lo = c->pos, hi, step = 1, mid;
+
+  if (lo >= c->size) return 0;
+  if (COCURSOR_AT(c,lo)->num >= num) return 1;
+  while (lo + step < c->size && COCURSOR_AT(c,lo+step)->num < num)
+  {
+    lo += step;
+    step *= 2;
+  }
+  hi = lo + step < c->size ? lo + step : c->size;
+  while (hi - lo > 1)
+  {
+    mid = (lo + hi) / 2;
+    if (COCURSOR_AT(c,mid)->num < num) lo = mid; else hi = mid;
+  }
+  c->pos = hi;
+  return hi < c->size;
+}
 
-  while (*queue && (*queue)->co->num < co->num)
-    queue = &((*queue)->next);
-  newentry->next = *queue;
-  *queue = newentry;
+/* Add minco, found to be concurrent to the preset of ev, to the 
+   co-relation of ev, and record it in the query if necessary. */
+void co_relation_add (event_t *ev, pe_queue_t *qu, int check,
+  int queryable, cond_t *minco)
+{
+  if(queryable){
+    nodelist_t *list3;
+    int check2 = 1;
+    for(list3 = (*query)->cut; list3 && check2 && !m_repeat; list3 = list3->next)
+      if(!strcmp(((cond_t*)(list3->node))->origin->name,minco->origin->name))  check2 = 0;
+    if(check2) //print_marking_pl(qu->marking);
+    {
+      if(marking_test(qu->marking, minco->origin) &&
+        !(nc_arc_role(ev->origin, minco->origin) & ARC_POST) &&
+        nodelist_find(minco->origin->conds, minco))
+        if (minco->origin->queried && minco->token)
+        {
+          if(check)
+          {
+            if(minco->pre_ev)
+              minco->pre_ev->queried = 1;
+            minco->queried = 1;
+          }
+          evscut_insert(&((*query)->evscut),minco->pre_ev);
+          nodelist_push(&((*query)->cut),minco);
+          (*query)->szcut++;
+        }
+    }
+  }
+  addto_coarray(&(ev->coarray),minco);
 }
 
 void co_relation (event_t *ev, pe_queue_t *qu, int check, 
   int queryable)
 {
-  cond_t  **co_ptr, ***colists;
+  cond_t  **co_ptr, *minco, *co;
+  cocursor_t *c, *small;
   int   evps = ev->preset_size, sz;
-  cqentry_t *queue = NULL;
-  char  finished = 0, *switched;
-  /* Find the maximal potential size of the intersection. */
-  int min = 0xfffffff;
-  for (sz = evps, co_ptr = ev->preset; sz--; co_ptr++)
-  {
-    int cosize = (*co_ptr)->co_common.inuse +
-        (*co_ptr)->co_private.inuse;
-    if (min > cosize) min = cosize;
-  }
-  ev->coarray = alloc_coarray(min + ev->postset_size);
-
-  /* Add first condition in each list to a "priority queue"
-     ordered by condition numbers. */
-  colists = MYmalloc(evps * sizeof(cond_t**));
-  switched = MYmalloc(evps * sizeof(char));
-  for (sz = evps, co_ptr = ev->preset+(evps-1); sz--; co_ptr--)
-  {
-    colists[sz] = (*co_ptr)->co_common.conds;
-    switched[sz] = 0;
-    if (!*colists[sz])
-    {
-      switched[sz] = 1;
-      colists[sz] = (*co_ptr)->co_private.conds;
-      if (!*colists[sz]) { finished = 1; break; }
-    }
-    if (*colists[sz])
-      insert_to_queue(&queue, MYmalloc(sizeof(cqentry_t)),
-          *(colists[sz]++),sz);
+  double start = stats? wall_time() : 0;
+
+  if (co_bitsets)
+  {
+    int count = cobits_intersect(ev->preset,evps,&co_ptr);
+    ev->coarray = alloc_coarray(count + ev->postset_size);
+    for (; *co_ptr; co_ptr++)
+      co_relation_add(ev,qu,check,queryable,*co_ptr);
+    goto finished;
   }
 
-  /* Take the next lowest condition out of the queue, check whether
-     it occurred in all input conditions, and feed the successors
-     into the queue. */
-  while (!finished)
+  /* Set up a cursor for each input condition and find the smallest
+     sequence, which bounds the size of the intersection. */
+  for (sz = 0, small = cocursors; sz < evps; sz++)
   {
-    cond_t *minco = queue->co;
-    int min = minco->num, count = 0;
+    c = cocursors + sz;
+    c->common = ev->preset[sz]->co_common.conds;
+    c->private = ev->preset[sz]->co_private.conds;
+    c->ncommon = ev->preset[sz]->co_common.inuse;
+    c->size = c->ncommon + ev->preset[sz]->co_private.inuse;
+    c->pos = 0;
+    if (c->size < small->size) small = c;
+  }
+  ev->coarray = alloc_coarray(small->size + ev->postset_size);
 
-    while (queue && queue->co->num == min)
+  /* Leapfrog: take the next candidate from the smallest sequence and 
+     look for it in the others; on a mismatch, skip the smallest 
+     sequence ahead to the condition found there. */
+  while (small->pos < small->size)
+  {
+    minco = COCURSOR_AT(small,small->pos);
+    for (c = cocursors; c < cocursors + evps; c++)
     {
-      cqentry_t *tmp = queue;
-      int index = tmp->index;
-      queue = queue->next;
-      count++;
-
-      if (!*colists[index])
-      {
-        if (!switched[index]++)
-          colists[index] = 
-            ev->preset[index]->co_private.conds;
-
-        if (!*colists[index])
-        {
-          free(tmp); finished = 1;
-          continue;
-        }
-      }
-      insert_to_queue(&queue,tmp,*(colists[index]++),index);
+      if (c == small) continue;
+      if (!cocursor_seek(c,minco->num)) goto finished;
+      if ((co = COCURSOR_AT(c,c->pos))->num > minco->num) break;
     }
-
-    if (count == evps){
-      if(queryable){
-        nodelist_t *list, *list2, *list3;
-        int check2 = 1;
-        for(list3 = (*query)->cut; list3 && check2 && !m_repeat; list3 = list3->next)
-          if(!strcmp(((cond_t*)(list3->node))->origin->name,minco->origin->name))  check2 = 0;
-        if(check2) //print_marking_pl(qu->marking);
-        {
-          for(list = qu->marking; list; list = list->next)
-            if(!nodelist_find(ev->origin->postset, list->node))
-              for(list2 = (((place_t*)(list->node))->conds); list2;
-                list2 = list2->next)
-                if (((cond_t*)(list2->node))->num == minco->num)
-                  if (minco->origin->queried && minco->token)
-                  {
-                    if(check)
-                    {
-                      if(minco->pre_ev)
-                        minco->pre_ev->queried = 1;
-                      minco->queried = 1;
-                    }
-                    nodelist_insert(&((*query)->evscut),minco->pre_ev);
-                    nodelist_push(&((*query)->cut),minco);
-                    (*query)->szcut++;
-                  }
-        }
-      }
-      addto_coarray(&(ev->coarray),minco);
+    if (c == cocursors + evps)
+    {
+      co_relation_add(ev,qu,check,queryable,minco);
+      small->pos++;
     }
+    else if (!cocursor_seek(small,co->num))
+      break;
   }
 
-  free(colists);
-  free(switched);
-  while (queue)
+finished:
+  if (stats)
   {
-    cqentry_t *tmp = queue;
-    queue = queue->next;
-    free(tmp);
+    co_relation_calls++;
+    co_relation_found += ev->coarray.inuse;
+    co_relation_time += wall_time() - start;
   }
 }
 
@@ -412,8 +539,8 @@ void recursive_add (nodelist_t *pre, nodelist_t *current)
 {
   if (!pre) return;
   recursive_add(pre->next,current);
-  addto_coarray(&(((cond_t*)(pre->node))->co_private),current->node);
-  addto_coarray(&(((cond_t*)(current->node))->co_private),pre->node);
+  add_private(pre->node,current->node);
+  add_private(current->node,pre->node);
 }
 
 void recursive_pe (nodelist_t *list)
@@ -431,7 +558,7 @@ void recursive_queried(querycell_t *qbuck, cond_t **co_ptr, int sz)
   {
     if(co_ptr[i]->pre_ev)
     {
-      nodelist_insert(&(qbuck->evscut),co_ptr[i]->pre_ev);
+      evscut_insert(&(qbuck->evscut),co_ptr[i]->pre_ev);
       if (qbuck->repeat > 0 && !co_ptr[i]->pre_ev->queried)
         co_ptr[i]->pre_ev->queried = 1;
       recursive_queried(qbuck, co_ptr[i]->pre_ev->preset, 
@@ -442,60 +569,72 @@ void recursive_queried(querycell_t *qbuck, cond_t **co_ptr, int sz)
 }
 
 
-void pred_conds(cond_t **conds_ev1, trans_t *tr1, cond_t **conds_ev2, trans_t* tr2, int id_ev1, int id_ev2)
+/* Set up the sorted numbers of the conditions consumed (or reset) by the
+   queue entry qu, which -confmax uses to detect direct conflicts. */
+void pred_conds (pe_queue_t *qu)
 {
-  int conum, i;
-  cond_t **co1 = conds_ev1, **co2 = conds_ev2;
-  
-  for(i = 0; i < tr1->prereset_size; i++)
-  {
-    conum = co1[i]->num + 1;
+  int i, j, num, size = qu->trans->prereset_size;
 
-    if (confl_evs[id_ev1][conum] == 0)
-      confl_evs[id_ev1][conum] = conum;
-  }
-
-  for(i = 0; i < tr2->prereset_size; i++)
+  if (qu->consumed) return;
+  qu->consumed = MYmalloc(size * sizeof(int));
+  for (i = 0; i < size; i++)
   {
-    conum = co2[i]->num + 1;
-    if (confl_evs[id_ev2][conum] == 0)
-      confl_evs[id_ev2][conum] = conum;
+    num = qu->conds[i]->num;
+    for (j = i; j > 0 && qu->consumed[j-1] > num; j--)
+      qu->consumed[j] = qu->consumed[j-1];
+    qu->consumed[j] = num;
   }
-  
 }
 
-int check_conflict(int id_ev1, int id_ev2, int size)
+/* Whether the queue entries qu1 and qu2 are in direct conflict, i.e.
+   consume a common condition. */
+int check_conflict (pe_queue_t *qu1, pe_queue_t *qu2)
 {
-  int num1, num2, conflyes = 0;
+  int *c1 = qu1->consumed, *e1 = c1 + qu1->trans->prereset_size;
+  int *c2 = qu2->consumed, *e2 = c2 + qu2->trans->prereset_size;
+
+  while (c1 < e1 && c2 < e2)
+    if (*c1 < *c2) c1++;
+    else if (*c2 < *c1) c2++;
+    else return 1;
+  return 0;
+}
 
-  for (int i = 1; i < size && !conflyes; i++)
+/*******************************************************************/
+/* Which of the budgets of -timeout, -max-events and -max-mem the run
+   has used up since 'start', or 0. The peak RSS is only looked at
+   every 64 events. */
+
+int budget_check (double start)
+{
+  struct rusage usage;
+
+  if (max_events && unf->numev >= max_events) return BUDGET_EVENTS;
+  if (max_time && wall_time() - start >= max_time) return BUDGET_TIME;
+  if (max_mem && !(unf->numev & 63))
   {
-    num1 = confl_evs[id_ev1][i];
-    num2 = confl_evs[id_ev2][i];
-    if (num1 > 0 && num1 <= unf->numco && num1 == num2)
-      conflyes = 1;
+    getrusage(RUSAGE_SELF,&usage);
+    if (usage.ru_maxrss >= max_mem) return BUDGET_MEMORY;
   }
-  
-  return conflyes;
+  return 0;
 }
 
 /*******************************************************************/
 
 void unfold ()
 {
-  nodelist_t *list, *list2, *mark_qr = NULL, *harmful_marking = NULL;
+  nodelist_t *list, *list2;
+  marking_t *m0, *mark_qr = NULL, *harmful_marking = NULL;
   pe_queue_t *qu;
   place_t *pl;
   event_t *ev, *ev2, *stopev = NULL;
   cond_t  *co;
   querycell_t *qbuck;
-  int i, cutoff, repeat = 0, check_query, harmful_check;
-  int conflsteps = CO_ALLOC_STEP;
-  confl_evs = MYmalloc(CO_ALLOC_STEP * sizeof(int*));
-  char trans_pool[(net->maxtrname+2)*(net->numtr)];
-  memset( trans_pool, 0, (net->maxtrname+2)*(net->numtr)*sizeof(char) );
-  char* command = NULL;
-  if (badunf) command = calloc((net->maxplname*net->numpl)+strlen(badunf)*2, sizeof(char));
+  int i, cutoff, repeat = 0, check_query, harmful_check, ckpt_next = 0;
+  int budgets = max_time || max_events || max_mem;
+  double start = wall_time();
+  char trans_pool[(net->maxtrname+2)*(net->numtr)+1];
+  memset( trans_pool, 0, sizeof(trans_pool) );
 
   /* create empty unfolding structure */
   unf = nc_create_unfolding();
@@ -505,19 +644,23 @@ void unfold ()
   events_size = conditions_size = ce_alloc_step
     = (net->maxpre > 2000)? (net->maxpre + 8) & 0xFFFFFFF8 : 2000;
   events = MYmalloc(events_size * sizeof(event_t*));
+  cocursors = MYmalloc((net->maxpre + net->maxres) * sizeof(cocursor_t));
 
   /* cut-off events, corresponding events */
   cutoff_list = corr_list = NULL;
 
   /* init hash table, add initial marking */
   marking_init(); unf->m0 = unf->m0_unmarked = NULL;
+  if (badunf) badness_init(badunf);
   mark_qr = retrieve_list("queried");
   /* printf("mark_qr\n");
   print_marking_pl(mark_qr); */
   harmful_marking = retrieve_list("harmful");
-  add_marking(list = retrieve_list("marked"),NULL);
-  check_query = nodelist_compare(list, mark_qr);
-  if(!check_query)
+  if (!marking_size(harmful_marking)) harmful_marking = NULL;
+  m0 = retrieve_list("marked");
+  if (!resume_file) add_marking(m0,NULL);
+  check_query = marking_compare(m0, mark_qr);
+  if(!check_query && !resume_file)
   {
     qbuck = MYmalloc(sizeof(querycell_t));
     qbuck->repeat = 1;
@@ -531,57 +674,74 @@ void unfold ()
 
   if (verbose || interactive){
     printf("Initial marking:\n");
-    print_marking_pl(list);
+    print_marking_pl(m0);
     printf("\n");
   }
 
   /* initialize PE computation */
-  pe_init(list);
+  if (co_bitsets) cobits_init();
+  pe_init(m0);
   parikh_init();
 
-  for (pl = net->places; pl; pl = pl->next){
-    if(!pl->marked && pl->reset != NULL){
-      co = insert_condition(pl,NULL,0,0);
-      co->co_common = alloc_coarray(0);
-      co->co_private = alloc_coarray(0);
-      nodelist_push(&(unf->m0_unmarked),co);
+  /* either go on from a checkpoint or start with the initial conditions */
+  if (resume_file)
+  {
+    checkpoint_load(&repeat,trans_pool);
+    if (unf->numev >= events_size)
+    {
+      events_size = unf->numev + ce_alloc_step;
+      events = MYrealloc(events,events_size * sizeof(event_t*));
     }
   }
-  /* add initial conditions to unfolding, compute possible extensions */
-  for (; list; list = list->next)
+  else
   {
-    co = insert_condition(pl = list->node,NULL, 
-      (!m_repeat && !check_query) ||
-      (!check_query && find_marking(mark_qr, 1) > 0) ? 1 : 0, !check_query);
-    co->co_common = alloc_coarray(0);
-    co->co_private = alloc_coarray(0);
-    nodelist_push(&(unf->m0),co);
-  }
+    for (pl = net->places; pl; pl = pl->next){
+      if(!pl->marked && pl->reset != NULL){
+        co = insert_condition(pl,NULL,0,0);
+        co->co_common = alloc_coarray(0);
+        co->co_private = alloc_coarray(0);
+        nodelist_push(&(unf->m0_unmarked),co);
+      }
+    }
+    /* add initial conditions to unfolding, compute possible extensions */
+    for (list = marking_to_list(m0); list; list = list->next)
+    {
+      co = insert_condition(pl = list->node,NULL, 
+        (!m_repeat && !check_query) ||
+        (!check_query && find_marking(mark_qr, 1) > 0) ? 1 : 0, !check_query);
+      co->co_common = alloc_coarray(0);
+      co->co_private = alloc_coarray(0);
+      nodelist_push(&(unf->m0),co);
+    }
   
-  if(verbose)
-  {
-    printf("Unfolding initial marking plus resets:\n");
-    print_marking_co(nodelist_concatenate(unf->m0, unf->m0_unmarked));
-    printf("\n");
-  }
-
-  recursive_pe(nodelist_concatenate(unf->m0, unf->m0_unmarked));
+    if(verbose)
+    {
+      printf("Unfolding initial marking plus resets:\n");
+      print_marking_co(nodelist_concatenate(unf->m0, unf->m0_unmarked));
+      printf("\n");
+    }
 
+    recursive_pe(nodelist_concatenate(unf->m0, unf->m0_unmarked));
+  }
+  if (ckpt_every) ckpt_next = (unf->numev / ckpt_every + 1) * ckpt_every;
 
-  if(confmax)
-    for (i = 0; i < conflsteps; i++)
-      confl_evs[i] = MYcalloc(conflsteps * sizeof(confl_evs));
   /* take the next event from the queue */
   while (pe_qsize)
   {
     int e, ev_choice;
     check_query = 1; harmful_check = 1;
-    if(confmax && pe_qsize > unf->numev + unf->numco)
+
+    /* when a budget is used up, stop with the prefix built so far */
+    if (budgets) budget_hit = budget_check(start);
+    if (ckpt_every && (unf->numev >= ckpt_next || budget_hit))
+    {
+      checkpoint_save(repeat,trans_pool);
+      ckpt_next += ckpt_every;
+    }
+    if (budget_hit)
     {
-      conflsteps += CO_ALLOC_STEP;
-      confl_evs = MYrealloc(confl_evs, conflsteps * sizeof(int*));
-      for (i = conflsteps-CO_ALLOC_STEP; i < conflsteps; i++) 
-        confl_evs[i] = MYcalloc(conflsteps * sizeof(confl_evs));
+      budget_pending = pe_qsize;
+      break;
     }
 
     if (interactive) for (;;)
@@ -605,8 +765,9 @@ void unfold ()
         {
           if (i != ev_choice)
           {
-            pred_conds(pe_queue[ev_choice]->conds, pe_queue[ev_choice]->trans, pe_queue[i]->conds, pe_queue[i]->trans, pe_queue[ev_choice]->id, pe_queue[i]->id);
-            if(check_conflict(pe_queue[ev_choice]->id, pe_queue[i]->id, conflsteps))
+            pred_conds(pe_queue[ev_choice]);
+            pred_conds(pe_queue[i]);
+            if(check_conflict(pe_queue[ev_choice], pe_queue[i]))
             {
               qu = pe_pop(i); 
               i = 0; 
@@ -627,21 +788,18 @@ void unfold ()
     /* add event to the unfolding */
     ev = insert_event(qu, trans_pool);
     cutoff = add_marking(qu->marking,ev);
-    check_query = nodelist_compare(qu->marking, mark_qr);
+    if (mcistream && !cutoff) mci_stream_cutoff(ev,corr_list->node);
+    check_query = marking_compare(qu->marking, mark_qr);
     /* if(!check_query) 
     {
       printf("qu->marking\n");
       print_marking_pl(qu->marking);
     } */
-    for(list = harmful_marking; list && harmful_check;
-      list = list->next)
-      if(!nodelist_find(qu->marking, list->node)){
-        harmful_check = 0;
-      }
+    if(harmful_marking && !marking_subset(harmful_marking, qu->marking))
+      harmful_check = 0;
     if (badunf)
     {
-      sprintf(command, "./badness_check \"%s\" \"%s\"", badunf, mrk2str(qu->marking));
-      harmful_check = system(command)/256;
+      harmful_check = badness_check(qu->marking);
       harmful_marking = qu->marking;
       //harmful_marking = NULL;
     }
@@ -682,7 +840,10 @@ void unfold ()
     {
       unf->events = unf->events->next; 
       if(harmful_marking && harmful_check)
+      {
         nodelist_push(&harmful_list,ev);
+        if (mcistream) mci_stream_harmful(ev);
+      }
       else if(freechk && badunf)
         {stopev = ev; break;}
     }
@@ -704,6 +865,7 @@ void unfold ()
     {
       unf->events = unf->events->next; 
       nodelist_push(&harmful_list,ev);
+      if (mcistream) mci_stream_harmful(ev);
       add_post_conditions(ev,HARMFUL_YES, repeat, !check_query);
       //stopev = ev; break;
       continue;
@@ -761,11 +923,68 @@ void unfold ()
         !nodelist_find(harmful_list, stopev))
     {stopev->next = unf->events; unf->events = stopev;}
   }
+  if (mcistream) mci_stream_close(stopev);
+
+  unfold_time = wall_time() - start;
 
   /* release memory that is no longer needed (probably incomplete) */
   pe_finish();
   parikh_finish();
   free(events);
+  free(cocursors);
+  if (badunf) badness_finish();
   for (pl = net->places; pl; pl = pl->next)
     nodelist_delete(pl->conds);  
 }
+
+
+/*******************************************************************/
+/* Release the memory of the unfolding in one go. */
+
+void release_unfolding ()
+{
+  if (co_bitsets) cobits_finish();
+  if (mcmillan) cobits_history_finish();
+  arena_free(unf->arena);
+  memset(coa_freelist,0,sizeof(coa_freelist));
+  coa_bytes = 0;
+  free(unf);
+  unf = NULL;
+}
+
+/* Report the work done by co_relation (-stats). */
+
+void co_relation_stats ()
+{
+  printf("Co-relation: %ld intersections with %ld conditions in %.3fs",
+    co_relation_calls, co_relation_found, co_relation_time);
+  if (co_relation_time > 0)
+    printf(" (%.0f intersections per second)",
+      co_relation_calls / co_relation_time);
+  printf("\n");
+}
+
+/* Report memory usage (-stats); 'when' tells whether the unfolding
+   is still in memory. */
+
+void memory_stats (char *when)
+{
+  struct rusage usage;
+  long pages = 0, rss = 0;
+  FILE *statm;
+
+  if ((statm = fopen("/proc/self/statm","r")))
+  {
+    if (fscanf(statm,"%ld %ld",&pages,&rss) != 2) rss = 0;
+    fclose(statm);
+  }
+  rss *= sysconf(_SC_PAGESIZE) / 1024;
+  getrusage(RUSAGE_SELF,&usage);
+
+  printf("Memory %s: RSS %ld kB, peak RSS %ld kB",
+    when, rss, usage.ru_maxrss);
+  if (unf)
+    printf(", unfolding arena %ld kB (%ld kB co-arrays)",
+      (long)(unf->arena->total / 1024), coa_bytes / 1024);
+  printf("\n");
+}
\ No newline at end of file
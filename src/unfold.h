@@ -21,9 +21,8 @@ extern querycell_t **query; /* stores cuts that have been queried to allow a pos
 extern int conditions_size, events_size;
 extern int ev_mark;          /* needed for various procedures */
 extern int hash_buckets;
+extern double hash_load;
 extern event_t **events;
-extern int conflsteps;
-extern int** confl_evs;
 extern char* badunf;
 extern char* qrmarking;     /* marking queried from user prompt */
 extern char* rtplaces;     /* places restricted from user prompt */
@@ -40,34 +39,63 @@ extern int m_repeat;    /* whether the -r switch has been supplied */
 extern int verbose;    /* whether the -verbose switch has been supplied */
 extern int freechk;  /* whether the -freechk has been supplied */
 extern int useids;  /* whether the -useids has been supplied */
+extern int stats;  /* whether statistics are kept (-stats, -stats-json) */
+extern double max_time;  /* argument of -timeout, in seconds */
+extern int max_events;   /* argument of -max-events */
+extern long max_mem;     /* argument of -max-mem, in kB */
+
+/* the budget that cut the run short, written to the .mci file with the
+   number of possible extensions left */
+enum { BUDGET_TIME = 1, BUDGET_EVENTS, BUDGET_MEMORY };
+extern int budget_hit, budget_pending;
 
 extern nodelist_t *cutoff_list, *corr_list;  /* cut-off/corresponding list */
 extern nodelist_t *harmful_list;  /* bad or harmful events in a list */
 
 extern void unfold(); /* the unfolding procedure */
+extern void release_unfolding(); /* free the memory of the unfolding */
+extern void memory_stats(char*); /* memory usage for -stats */
+extern void co_relation_stats(); /* time spent in co_relation, for -stats */
+extern long co_relation_calls, co_relation_found; /* for -stats */
+extern double co_relation_time, unfold_time;
+extern long coa_bytes;
 extern cond_t* insert_condition(place_t*, event_t*, int, int);  
 /* insert a condition to the unfolding */
 extern coa_t alloc_coarray (int); /* Create an empty coarray with 'size'
  allocated events. */
-extern int check_conflict(int, int, int);
-extern void pred_conds( cond_t**, trans_t*, cond_t**, trans_t*, int, int);
+extern int co_concurrent (cond_t*,cond_t*); /* whether two conditions
+ are in the co-relation */
 extern void print_conditions (cond_t*);
 extern void print_events (event_t*);
 
 /***************************************************************************/
 /* declarations for marking.c              */
 
+extern int marking_words;  /* number of 64-bit words in a marking */
+extern int hash_count;     /* number of markings in the table */
+extern int hash_resizes, hash_maxprobe;  /* for -stats */
+extern long long hash_lookups, hash_probes;
+extern long add_marking_calls;
+extern double add_marking_time;
+
 extern void marking_init ();
-extern int marking_hash (nodelist_t *);
-extern int repeated_marking(nodelist_t*);
-extern int find_marking (nodelist_t*, int);
-extern int add_marking (nodelist_t*,event_t*);
-extern nodelist_t* retrieve_list (char*); /* values among "marked", "queried"
+extern marking_t* marking_alloc ();
+extern void marking_set (marking_t*, place_t*);
+extern int marking_test (marking_t*, place_t*);
+extern unsigned long long marking_hash (marking_t*);
+extern int marking_compare (marking_t*, marking_t*);
+extern int marking_size (marking_t*);
+extern int marking_subset (marking_t*, marking_t*);
+extern nodelist_t* marking_to_list (marking_t*);
+extern int find_marking (marking_t*, int);
+extern int add_marking (marking_t*,event_t*);
+extern marking_t* retrieve_list (char*); /* values among "marked", "queried"
   and "harmful" are expected */
 // extern nodelist_t* format_marking_query ();
-extern void print_marking_pl (nodelist_t*);
+extern void print_marking_pl (marking_t*);
 extern void print_marking_co (nodelist_t*);
-extern char* mrk2str (nodelist_t*);
+extern char* mrk2str (marking_t*);
+extern void marking_stats ();
 
 
 
@@ -82,21 +110,90 @@ typedef struct pe_queue_t
   struct parikh_t *p_vector;  /* Parikh vector    */
   trans_t  *trans;    /* transition           */
   cond_t  **conds;    /* input conditions     */
-  nodelist_t *marking;    /* marking associated with [e]  */
+  marking_t *marking;    /* marking associated with [e]  */
+  struct foata_t *foata;  /* Foata normal form, computed on demand */
+  int *consumed;      /* sorted numbers of conds (-confmax only) */
   int id;
 } pe_queue_t;
 
 extern cond_t **pe_conds; /* array of conditions */
 
-extern void pe_init (nodelist_t*);
+extern void pe_init (marking_t*);
+extern void pe_append (pe_queue_t*);
 extern pe_queue_t* pe_pop (int);
 extern void pe_free (pe_queue_t*);
 extern void pe_finish ();
 extern void pe (cond_t*);
 
+extern void pe_parallel (cond_t**,int);
+extern void pred_conds (pe_queue_t*);
+extern int check_conflict (pe_queue_t*,pe_queue_t*);
+
+extern int pe_threads;  /* argument of the -j switch */
+extern int pe_stopped;  /* whether the -T transition has been queued */
+extern long pe_calls, pe_narrows, pe_narrow_fails;  /* for -stats */
+extern double pe_time, pe_narrow_time;
+extern int pe_qpeak;
 extern int pe_qsize;
 extern pe_queue_t **pe_queue;
 
+/***************************************************************************/
+/* declarations for cobits.c              */
+
+#define COBITS_CHUNK 256
+
+typedef struct cochunk_t
+{
+  unsigned long long w[COBITS_CHUNK/64];
+} cochunk_t;
+
+typedef struct cobits_t
+{
+  int size, inuse;     /* allocated/used chunks */
+  int *index;          /* chunk numbers, ascending */
+  cochunk_t *chunks;
+} cobits_t;
+
+extern int co_bitsets;   /* whether the -cobits switch has been supplied */
+extern cobits_t *cobits_common, *cobits_private;
+
+extern void cobits_init ();
+extern void cobits_finish ();
+extern void cobits_new_condition (cond_t*);
+extern void cobits_add_private (cond_t*,cond_t*);
+extern int cobits_test (cobits_t*,int);
+extern cobits_t* cobits_history (event_t*);
+extern void cobits_history_finish ();
+extern cobits_t cobits_from_coarray (coa_t);
+extern int cobits_intersect (cond_t**,int,cond_t***);
+
+/***************************************************************************/
+/* declarations for badness.c              */
+
+extern char *badcache;   /* argument of the -badcache switch */
+
+extern void badness_init (char*);
+extern int badness_check (marking_t*);
+extern void badness_finish ();
+extern void badness_stats ();
+
+/***************************************************************************/
+/* declarations for stats.c              */
+
+extern char *stats_json;  /* argument of the -stats-json switch */
+
+extern void stats_write (char*,char*);
+
+/***************************************************************************/
+/* declarations for checkpoint.c              */
+
+extern char *ckpt_file;    /* argument of the -checkpoint switch */
+extern int ckpt_every;     /* argument of the -every switch */
+extern char *resume_file;  /* argument of the -resume switch */
+
+extern void checkpoint_save (int,char*);
+extern void checkpoint_load (int*,char*);
+
 /***************************************************************************/
 /* declarations for order.c              */
 
@@ -106,8 +203,26 @@ typedef struct parikh_t
   unsigned short int appearances;
 } parikh_t;
 
+/* The Foata normal form of [e] as one Parikh vector per level; the
+   vectors are stored one after the other in 'slices', each ending
+   with an entry whose tr_num is 0. */
+
+typedef struct foata_t
+{
+  int levels;
+  int *sizes;          /* number of events per level */
+  parikh_t *slices;
+} foata_t;
+
+extern int queue_count;  /* number of queue entries created so far */
+extern int foata_compares, foata_cached;  /* for -stats */
+extern double foata_time, create_queue_time;
+extern long create_queue_calls;
+
 extern void parikh_init ();
 extern void parikh_finish ();
+extern void foata_free (foata_t*);
+extern void foata_stats ();
 extern pe_queue_t* create_queue_entry (trans_t*);
 extern int pe_compare (pe_queue_t*,pe_queue_t*);
 extern int find_foata_level (pe_queue_t*);